@@ -10,9 +10,178 @@ Rcpp::Rostream<true>&  Rcpp::Rcout = Rcpp::Rcpp_cout_get();
 Rcpp::Rostream<false>& Rcpp::Rcerr = Rcpp::Rcpp_cerr_get();
 #endif
 
+// enable_adaptive_compressor
+void enable_adaptive_compressor(SEXP compressorPtr, double target_mbps, double max_latency_ms);
+RcppExport SEXP _zlib_enable_adaptive_compressor(SEXP compressorPtrSEXP, SEXP target_mbpsSEXP, SEXP max_latency_msSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type compressorPtr(compressorPtrSEXP);
+    Rcpp::traits::input_parameter< double >::type target_mbps(target_mbpsSEXP);
+    Rcpp::traits::input_parameter< double >::type max_latency_ms(max_latency_msSEXP);
+    enable_adaptive_compressor(compressorPtr, target_mbps, max_latency_ms);
+    return R_NilValue;
+END_RCPP
+}
+// compressor_decisions
+DataFrame compressor_decisions(SEXP compressorPtr);
+RcppExport SEXP _zlib_compressor_decisions(SEXP compressorPtrSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type compressorPtr(compressorPtrSEXP);
+    rcpp_result_gen = Rcpp::wrap(compressor_decisions(compressorPtr));
+    return rcpp_result_gen;
+END_RCPP
+}
+// collect_compressor_output
+RawVector collect_compressor_output(SEXP compressorPtr, bool wait);
+RcppExport SEXP _zlib_collect_compressor_output(SEXP compressorPtrSEXP, SEXP waitSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type compressorPtr(compressorPtrSEXP);
+    Rcpp::traits::input_parameter< bool >::type wait(waitSEXP);
+    rcpp_result_gen = Rcpp::wrap(collect_compressor_output(compressorPtr, wait));
+    return rcpp_result_gen;
+END_RCPP
+}
+// compress_many
+List compress_many(const List& data, int level, int wbits, int memLevel, int strategy, Nullable<RawVector> zdict, int threads);
+RcppExport SEXP _zlib_compress_many(SEXP dataSEXP, SEXP levelSEXP, SEXP wbitsSEXP, SEXP memLevelSEXP, SEXP strategySEXP, SEXP zdictSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const List& >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< int >::type level(levelSEXP);
+    Rcpp::traits::input_parameter< int >::type wbits(wbitsSEXP);
+    Rcpp::traits::input_parameter< int >::type memLevel(memLevelSEXP);
+    Rcpp::traits::input_parameter< int >::type strategy(strategySEXP);
+    Rcpp::traits::input_parameter< Nullable<RawVector> >::type zdict(zdictSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(compress_many(data, level, wbits, memLevel, strategy, zdict, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// decompress_many
+List decompress_many(const List& data, int wbits, Nullable<RawVector> zdict, int threads);
+RcppExport SEXP _zlib_decompress_many(SEXP dataSEXP, SEXP wbitsSEXP, SEXP zdictSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const List& >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< int >::type wbits(wbitsSEXP);
+    Rcpp::traits::input_parameter< Nullable<RawVector> >::type zdict(zdictSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(decompress_many(data, wbits, zdict, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// create_bgzf_compressor
+SEXP create_bgzf_compressor(int level, int threads);
+RcppExport SEXP _zlib_create_bgzf_compressor(SEXP levelSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type level(levelSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(create_bgzf_compressor(level, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// bgzf_compress
+RawVector bgzf_compress(const RawVector& data, int level, int threads);
+RcppExport SEXP _zlib_bgzf_compress(SEXP dataSEXP, SEXP levelSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const RawVector& >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< int >::type level(levelSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(bgzf_compress(data, level, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// bgzf_decompress
+RawVector bgzf_decompress(const RawVector& data, int threads);
+RcppExport SEXP _zlib_bgzf_decompress(SEXP dataSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const RawVector& >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(bgzf_decompress(data, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// bgzf_read_file
+RawVector bgzf_read_file(const std::string& file_path, double virtual_offset, double length, int threads);
+RcppExport SEXP _zlib_bgzf_read_file(SEXP file_pathSEXP, SEXP virtual_offsetSEXP, SEXP lengthSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type file_path(file_pathSEXP);
+    Rcpp::traits::input_parameter< double >::type virtual_offset(virtual_offsetSEXP);
+    Rcpp::traits::input_parameter< double >::type length(lengthSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(bgzf_read_file(file_path, virtual_offset, length, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// crc32_checksum
+double crc32_checksum(const RawVector& x, double init, int threads);
+RcppExport SEXP _zlib_crc32_checksum(SEXP xSEXP, SEXP initSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const RawVector& >::type x(xSEXP);
+    Rcpp::traits::input_parameter< double >::type init(initSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(crc32_checksum(x, init, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// adler32_checksum
+double adler32_checksum(const RawVector& x, double init, int threads);
+RcppExport SEXP _zlib_adler32_checksum(SEXP xSEXP, SEXP initSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const RawVector& >::type x(xSEXP);
+    Rcpp::traits::input_parameter< double >::type init(initSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(adler32_checksum(x, init, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// crc32_combine_checksums
+double crc32_combine_checksums(double crc1, double crc2, double len2);
+RcppExport SEXP _zlib_crc32_combine_checksums(SEXP crc1SEXP, SEXP crc2SEXP, SEXP len2SEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< double >::type crc1(crc1SEXP);
+    Rcpp::traits::input_parameter< double >::type crc2(crc2SEXP);
+    Rcpp::traits::input_parameter< double >::type len2(len2SEXP);
+    rcpp_result_gen = Rcpp::wrap(crc32_combine_checksums(crc1, crc2, len2));
+    return rcpp_result_gen;
+END_RCPP
+}
+// adler32_combine_checksums
+double adler32_combine_checksums(double adler1, double adler2, double len2);
+RcppExport SEXP _zlib_adler32_combine_checksums(SEXP adler1SEXP, SEXP adler2SEXP, SEXP len2SEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< double >::type adler1(adler1SEXP);
+    Rcpp::traits::input_parameter< double >::type adler2(adler2SEXP);
+    Rcpp::traits::input_parameter< double >::type len2(len2SEXP);
+    rcpp_result_gen = Rcpp::wrap(adler32_combine_checksums(adler1, adler2, len2));
+    return rcpp_result_gen;
+END_RCPP
+}
 // create_compressor
-SEXP create_compressor(int level, int method, int wbits, int memLevel, int strategy, Nullable<RawVector> zdict);
-RcppExport SEXP _zlib_create_compressor(SEXP levelSEXP, SEXP methodSEXP, SEXP wbitsSEXP, SEXP memLevelSEXP, SEXP strategySEXP, SEXP zdictSEXP) {
+SEXP create_compressor(int level, int method, int wbits, int memLevel, int strategy, Nullable<RawVector> zdict, bool async, int queue_size, Nullable<List> header);
+RcppExport SEXP _zlib_create_compressor(SEXP levelSEXP, SEXP methodSEXP, SEXP wbitsSEXP, SEXP memLevelSEXP, SEXP strategySEXP, SEXP zdictSEXP, SEXP asyncSEXP, SEXP queue_sizeSEXP, SEXP headerSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -22,7 +191,10 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< int >::type memLevel(memLevelSEXP);
     Rcpp::traits::input_parameter< int >::type strategy(strategySEXP);
     Rcpp::traits::input_parameter< Nullable<RawVector> >::type zdict(zdictSEXP);
-    rcpp_result_gen = Rcpp::wrap(create_compressor(level, method, wbits, memLevel, strategy, zdict));
+    Rcpp::traits::input_parameter< bool >::type async(asyncSEXP);
+    Rcpp::traits::input_parameter< int >::type queue_size(queue_sizeSEXP);
+    Rcpp::traits::input_parameter< Nullable<List> >::type header(headerSEXP);
+    rcpp_result_gen = Rcpp::wrap(create_compressor(level, method, wbits, memLevel, strategy, zdict, async, queue_size, header));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -50,6 +222,32 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// clone_compressor
+SEXP clone_compressor(SEXP compressorPtr);
+RcppExport SEXP _zlib_clone_compressor(SEXP compressorPtrSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type compressorPtr(compressorPtrSEXP);
+    rcpp_result_gen = Rcpp::wrap(clone_compressor(compressorPtr));
+    return rcpp_result_gen;
+END_RCPP
+}
+// create_zlib_connection
+SEXP create_zlib_connection(SEXP con, std::string mode, int wbits, int level, int buffer_size);
+RcppExport SEXP _zlib_create_zlib_connection(SEXP conSEXP, SEXP modeSEXP, SEXP wbitsSEXP, SEXP levelSEXP, SEXP buffer_sizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type con(conSEXP);
+    Rcpp::traits::input_parameter< std::string >::type mode(modeSEXP);
+    Rcpp::traits::input_parameter< int >::type wbits(wbitsSEXP);
+    Rcpp::traits::input_parameter< int >::type level(levelSEXP);
+    Rcpp::traits::input_parameter< int >::type buffer_size(buffer_sizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(create_zlib_connection(con, mode, wbits, level, buffer_size));
+    return rcpp_result_gen;
+END_RCPP
+}
 // zlib_constants
 List zlib_constants();
 RcppExport SEXP _zlib_zlib_constants() {
@@ -61,25 +259,28 @@ BEGIN_RCPP
 END_RCPP
 }
 // create_decompressor
-SEXP create_decompressor(int wbits);
-RcppExport SEXP _zlib_create_decompressor(SEXP wbitsSEXP) {
+SEXP create_decompressor(int wbits, Nullable<RawVector> zdict, bool detect);
+RcppExport SEXP _zlib_create_decompressor(SEXP wbitsSEXP, SEXP zdictSEXP, SEXP detectSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< int >::type wbits(wbitsSEXP);
-    rcpp_result_gen = Rcpp::wrap(create_decompressor(wbits));
+    Rcpp::traits::input_parameter< Nullable<RawVector> >::type zdict(zdictSEXP);
+    Rcpp::traits::input_parameter< bool >::type detect(detectSEXP);
+    rcpp_result_gen = Rcpp::wrap(create_decompressor(wbits, zdict, detect));
     return rcpp_result_gen;
 END_RCPP
 }
 // decompress_chunk
-RawVector decompress_chunk(SEXP decompressorPtr, const RawVector& input_chunk);
-RcppExport SEXP _zlib_decompress_chunk(SEXP decompressorPtrSEXP, SEXP input_chunkSEXP) {
+RawVector decompress_chunk(SEXP decompressorPtr, const RawVector& input_chunk, double max_output);
+RcppExport SEXP _zlib_decompress_chunk(SEXP decompressorPtrSEXP, SEXP input_chunkSEXP, SEXP max_outputSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< SEXP >::type decompressorPtr(decompressorPtrSEXP);
     Rcpp::traits::input_parameter< const RawVector& >::type input_chunk(input_chunkSEXP);
-    rcpp_result_gen = Rcpp::wrap(decompress_chunk(decompressorPtr, input_chunk));
+    Rcpp::traits::input_parameter< double >::type max_output(max_outputSEXP);
+    rcpp_result_gen = Rcpp::wrap(decompress_chunk(decompressorPtr, input_chunk, max_output));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -95,6 +296,328 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// clone_decompressor
+SEXP clone_decompressor(SEXP decompressorPtr);
+RcppExport SEXP _zlib_clone_decompressor(SEXP decompressorPtrSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type decompressorPtr(decompressorPtrSEXP);
+    rcpp_result_gen = Rcpp::wrap(clone_decompressor(decompressorPtr));
+    return rcpp_result_gen;
+END_RCPP
+}
+// decompressor_members
+DataFrame decompressor_members(SEXP decompressorPtr, bool drain);
+RcppExport SEXP _zlib_decompressor_members(SEXP decompressorPtrSEXP, SEXP drainSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type decompressorPtr(decompressorPtrSEXP);
+    Rcpp::traits::input_parameter< bool >::type drain(drainSEXP);
+    rcpp_result_gen = Rcpp::wrap(decompressor_members(decompressorPtr, drain));
+    return rcpp_result_gen;
+END_RCPP
+}
+// train_dictionary
+RawVector train_dictionary(const List& samples, int size);
+RcppExport SEXP _zlib_train_dictionary(SEXP samplesSEXP, SEXP sizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const List& >::type samples(samplesSEXP);
+    Rcpp::traits::input_parameter< int >::type size(sizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(train_dictionary(samples, size));
+    return rcpp_result_gen;
+END_RCPP
+}
+// register_dictionary
+double register_dictionary(const RawVector& zdict);
+RcppExport SEXP _zlib_register_dictionary(SEXP zdictSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const RawVector& >::type zdict(zdictSEXP);
+    rcpp_result_gen = Rcpp::wrap(register_dictionary(zdict));
+    return rcpp_result_gen;
+END_RCPP
+}
+// unregister_dictionary
+bool unregister_dictionary(double id);
+RcppExport SEXP _zlib_unregister_dictionary(SEXP idSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< double >::type id(idSEXP);
+    rcpp_result_gen = Rcpp::wrap(unregister_dictionary(id));
+    return rcpp_result_gen;
+END_RCPP
+}
+// gzip_file
+double gzip_file(const std::string& input_path, const std::string& output_path, int level, int wbits, int memLevel, int strategy, double buffer_size);
+RcppExport SEXP _zlib_gzip_file(SEXP input_pathSEXP, SEXP output_pathSEXP, SEXP levelSEXP, SEXP wbitsSEXP, SEXP memLevelSEXP, SEXP strategySEXP, SEXP buffer_sizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type input_path(input_pathSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type output_path(output_pathSEXP);
+    Rcpp::traits::input_parameter< int >::type level(levelSEXP);
+    Rcpp::traits::input_parameter< int >::type wbits(wbitsSEXP);
+    Rcpp::traits::input_parameter< int >::type memLevel(memLevelSEXP);
+    Rcpp::traits::input_parameter< int >::type strategy(strategySEXP);
+    Rcpp::traits::input_parameter< double >::type buffer_size(buffer_sizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(gzip_file(input_path, output_path, level, wbits, memLevel, strategy, buffer_size));
+    return rcpp_result_gen;
+END_RCPP
+}
+// gunzip_file
+double gunzip_file(const std::string& input_path, const std::string& output_path, int wbits, double buffer_size);
+RcppExport SEXP _zlib_gunzip_file(SEXP input_pathSEXP, SEXP output_pathSEXP, SEXP wbitsSEXP, SEXP buffer_sizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type input_path(input_pathSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type output_path(output_pathSEXP);
+    Rcpp::traits::input_parameter< int >::type wbits(wbitsSEXP);
+    Rcpp::traits::input_parameter< double >::type buffer_size(buffer_sizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(gunzip_file(input_path, output_path, wbits, buffer_size));
+    return rcpp_result_gen;
+END_RCPP
+}
+// gzip_info
+List gzip_info(SEXP x);
+RcppExport SEXP _zlib_gzip_info(SEXP xSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type x(xSEXP);
+    rcpp_result_gen = Rcpp::wrap(gzip_info(x));
+    return rcpp_result_gen;
+END_RCPP
+}
+// build_gzip_index
+SEXP build_gzip_index(const std::string& file_path, double span);
+RcppExport SEXP _zlib_build_gzip_index(SEXP file_pathSEXP, SEXP spanSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type file_path(file_pathSEXP);
+    Rcpp::traits::input_parameter< double >::type span(spanSEXP);
+    rcpp_result_gen = Rcpp::wrap(build_gzip_index(file_path, span));
+    return rcpp_result_gen;
+END_RCPP
+}
+// save_gzip_index
+void save_gzip_index(SEXP index, const std::string& index_path);
+RcppExport SEXP _zlib_save_gzip_index(SEXP indexSEXP, SEXP index_pathSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type index(indexSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type index_path(index_pathSEXP);
+    save_gzip_index(index, index_path);
+    return R_NilValue;
+END_RCPP
+}
+// load_gzip_index
+SEXP load_gzip_index(const std::string& index_path);
+RcppExport SEXP _zlib_load_gzip_index(SEXP index_pathSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type index_path(index_pathSEXP);
+    rcpp_result_gen = Rcpp::wrap(load_gzip_index(index_path));
+    return rcpp_result_gen;
+END_RCPP
+}
+// gz_read_range
+RawVector gz_read_range(const std::string& file_path, double offset, double length, SEXP index);
+RcppExport SEXP _zlib_gz_read_range(SEXP file_pathSEXP, SEXP offsetSEXP, SEXP lengthSEXP, SEXP indexSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type file_path(file_pathSEXP);
+    Rcpp::traits::input_parameter< double >::type offset(offsetSEXP);
+    Rcpp::traits::input_parameter< double >::type length(lengthSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type index(indexSEXP);
+    rcpp_result_gen = Rcpp::wrap(gz_read_range(file_path, offset, length, index));
+    return rcpp_result_gen;
+END_RCPP
+}
+// lazy_raw
+SEXP lazy_raw(const RawVector& data, double block_size, int level, int cache_blocks);
+RcppExport SEXP _zlib_lazy_raw(SEXP dataSEXP, SEXP block_sizeSEXP, SEXP levelSEXP, SEXP cache_blocksSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const RawVector& >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< double >::type block_size(block_sizeSEXP);
+    Rcpp::traits::input_parameter< int >::type level(levelSEXP);
+    Rcpp::traits::input_parameter< int >::type cache_blocks(cache_blocksSEXP);
+    rcpp_result_gen = Rcpp::wrap(lazy_raw(data, block_size, level, cache_blocks));
+    return rcpp_result_gen;
+END_RCPP
+}
+// decompress_lazy
+SEXP decompress_lazy(const RawVector& data, int wbits, Nullable<RawVector> zdict, double block_size, int level, int cache_blocks);
+RcppExport SEXP _zlib_decompress_lazy(SEXP dataSEXP, SEXP wbitsSEXP, SEXP zdictSEXP, SEXP block_sizeSEXP, SEXP levelSEXP, SEXP cache_blocksSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const RawVector& >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< int >::type wbits(wbitsSEXP);
+    Rcpp::traits::input_parameter< Nullable<RawVector> >::type zdict(zdictSEXP);
+    Rcpp::traits::input_parameter< double >::type block_size(block_sizeSEXP);
+    Rcpp::traits::input_parameter< int >::type level(levelSEXP);
+    Rcpp::traits::input_parameter< int >::type cache_blocks(cache_blocksSEXP);
+    rcpp_result_gen = Rcpp::wrap(decompress_lazy(data, wbits, zdict, block_size, level, cache_blocks));
+    return rcpp_result_gen;
+END_RCPP
+}
+// lazy_raw_info
+SEXP lazy_raw_info(SEXP x);
+RcppExport SEXP _zlib_lazy_raw_info(SEXP xSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type x(xSEXP);
+    rcpp_result_gen = Rcpp::wrap(lazy_raw_info(x));
+    return rcpp_result_gen;
+END_RCPP
+}
+// compress_buffer
+RawVector compress_buffer(const RawVector& data, int level, int method, int wbits, int memLevel, int strategy, Nullable<RawVector> zdict, Nullable<List> header);
+RcppExport SEXP _zlib_compress_buffer(SEXP dataSEXP, SEXP levelSEXP, SEXP methodSEXP, SEXP wbitsSEXP, SEXP memLevelSEXP, SEXP strategySEXP, SEXP zdictSEXP, SEXP headerSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const RawVector& >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< int >::type level(levelSEXP);
+    Rcpp::traits::input_parameter< int >::type method(methodSEXP);
+    Rcpp::traits::input_parameter< int >::type wbits(wbitsSEXP);
+    Rcpp::traits::input_parameter< int >::type memLevel(memLevelSEXP);
+    Rcpp::traits::input_parameter< int >::type strategy(strategySEXP);
+    Rcpp::traits::input_parameter< Nullable<RawVector> >::type zdict(zdictSEXP);
+    Rcpp::traits::input_parameter< Nullable<List> >::type header(headerSEXP);
+    rcpp_result_gen = Rcpp::wrap(compress_buffer(data, level, method, wbits, memLevel, strategy, zdict, header));
+    return rcpp_result_gen;
+END_RCPP
+}
+// decompress_buffer
+RawVector decompress_buffer(const RawVector& data, int wbits, Nullable<RawVector> zdict);
+RcppExport SEXP _zlib_decompress_buffer(SEXP dataSEXP, SEXP wbitsSEXP, SEXP zdictSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const RawVector& >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< int >::type wbits(wbitsSEXP);
+    Rcpp::traits::input_parameter< Nullable<RawVector> >::type zdict(zdictSEXP);
+    rcpp_result_gen = Rcpp::wrap(decompress_buffer(data, wbits, zdict));
+    return rcpp_result_gen;
+END_RCPP
+}
+// compress_parallel
+RawVector compress_parallel(const RawVector& data, int level, int wbits, int memLevel, int strategy, Nullable<RawVector> zdict, int threads, double block_size);
+RcppExport SEXP _zlib_compress_parallel(SEXP dataSEXP, SEXP levelSEXP, SEXP wbitsSEXP, SEXP memLevelSEXP, SEXP strategySEXP, SEXP zdictSEXP, SEXP threadsSEXP, SEXP block_sizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const RawVector& >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< int >::type level(levelSEXP);
+    Rcpp::traits::input_parameter< int >::type wbits(wbitsSEXP);
+    Rcpp::traits::input_parameter< int >::type memLevel(memLevelSEXP);
+    Rcpp::traits::input_parameter< int >::type strategy(strategySEXP);
+    Rcpp::traits::input_parameter< Nullable<RawVector> >::type zdict(zdictSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< double >::type block_size(block_sizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(compress_parallel(data, level, wbits, memLevel, strategy, zdict, threads, block_size));
+    return rcpp_result_gen;
+END_RCPP
+}
+// gunzip_parallel
+RawVector gunzip_parallel(SEXP data, int threads, double chunk_size);
+RcppExport SEXP _zlib_gunzip_parallel(SEXP dataSEXP, SEXP threadsSEXP, SEXP chunk_sizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< double >::type chunk_size(chunk_sizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(gunzip_parallel(data, threads, chunk_size));
+    return rcpp_result_gen;
+END_RCPP
+}
+// zlib_memory
+NumericVector zlib_memory(Nullable<NumericVector> limit, Nullable<NumericVector> pool_size, bool trim);
+RcppExport SEXP _zlib_zlib_memory(SEXP limitSEXP, SEXP pool_sizeSEXP, SEXP trimSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Nullable<NumericVector> >::type limit(limitSEXP);
+    Rcpp::traits::input_parameter< Nullable<NumericVector> >::type pool_size(pool_sizeSEXP);
+    Rcpp::traits::input_parameter< bool >::type trim(trimSEXP);
+    rcpp_result_gen = Rcpp::wrap(zlib_memory(limit, pool_size, trim));
+    return rcpp_result_gen;
+END_RCPP
+}
+// compress_object
+SEXP compress_object(SEXP x, std::string file, int level, int wbits, int version);
+RcppExport SEXP _zlib_compress_object(SEXP xSEXP, SEXP fileSEXP, SEXP levelSEXP, SEXP wbitsSEXP, SEXP versionSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type x(xSEXP);
+    Rcpp::traits::input_parameter< std::string >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< int >::type level(levelSEXP);
+    Rcpp::traits::input_parameter< int >::type wbits(wbitsSEXP);
+    Rcpp::traits::input_parameter< int >::type version(versionSEXP);
+    rcpp_result_gen = Rcpp::wrap(compress_object(x, file, level, wbits, version));
+    return rcpp_result_gen;
+END_RCPP
+}
+// decompress_object
+SEXP decompress_object(SEXP data, int wbits);
+RcppExport SEXP _zlib_decompress_object(SEXP dataSEXP, SEXP wbitsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< int >::type wbits(wbitsSEXP);
+    rcpp_result_gen = Rcpp::wrap(decompress_object(data, wbits));
+    return rcpp_result_gen;
+END_RCPP
+}
+// compressor_stats
+List compressor_stats(SEXP compressorPtr);
+RcppExport SEXP _zlib_compressor_stats(SEXP compressorPtrSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type compressorPtr(compressorPtrSEXP);
+    rcpp_result_gen = Rcpp::wrap(compressor_stats(compressorPtr));
+    return rcpp_result_gen;
+END_RCPP
+}
+// decompressor_stats
+List decompressor_stats(SEXP decompressorPtr);
+RcppExport SEXP _zlib_decompressor_stats(SEXP decompressorPtrSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type decompressorPtr(decompressorPtrSEXP);
+    rcpp_result_gen = Rcpp::wrap(decompressor_stats(decompressorPtr));
+    return rcpp_result_gen;
+END_RCPP
+}
+// zlib_stats
+List zlib_stats();
+RcppExport SEXP _zlib_zlib_stats() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_result_gen = Rcpp::wrap(zlib_stats());
+    return rcpp_result_gen;
+END_RCPP
+}
 // validate_gzip_file
 bool validate_gzip_file(const std::string& file_path);
 RcppExport SEXP _zlib_validate_gzip_file(SEXP file_pathSEXP) {
@@ -106,20 +629,104 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// validate_gzip_files
+DataFrame validate_gzip_files(const CharacterVector& paths, int threads);
+RcppExport SEXP _zlib_validate_gzip_files(SEXP pathsSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const CharacterVector& >::type paths(pathsSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(validate_gzip_files(paths, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// ws_deflate_message
+RawVector ws_deflate_message(SEXP compressorPtr, const RawVector& message, bool no_context_takeover);
+RcppExport SEXP _zlib_ws_deflate_message(SEXP compressorPtrSEXP, SEXP messageSEXP, SEXP no_context_takeoverSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type compressorPtr(compressorPtrSEXP);
+    Rcpp::traits::input_parameter< const RawVector& >::type message(messageSEXP);
+    Rcpp::traits::input_parameter< bool >::type no_context_takeover(no_context_takeoverSEXP);
+    rcpp_result_gen = Rcpp::wrap(ws_deflate_message(compressorPtr, message, no_context_takeover));
+    return rcpp_result_gen;
+END_RCPP
+}
+// ws_inflate_message
+RawVector ws_inflate_message(SEXP decompressorPtr, const RawVector& payload, bool no_context_takeover, double max_size);
+RcppExport SEXP _zlib_ws_inflate_message(SEXP decompressorPtrSEXP, SEXP payloadSEXP, SEXP no_context_takeoverSEXP, SEXP max_sizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type decompressorPtr(decompressorPtrSEXP);
+    Rcpp::traits::input_parameter< const RawVector& >::type payload(payloadSEXP);
+    Rcpp::traits::input_parameter< bool >::type no_context_takeover(no_context_takeoverSEXP);
+    Rcpp::traits::input_parameter< double >::type max_size(max_sizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(ws_inflate_message(decompressorPtr, payload, no_context_takeover, max_size));
+    return rcpp_result_gen;
+END_RCPP
+}
 
 static const R_CallMethodDef CallEntries[] = {
-    {"_zlib_create_compressor", (DL_FUNC) &_zlib_create_compressor, 6},
+    {"_zlib_enable_adaptive_compressor", (DL_FUNC) &_zlib_enable_adaptive_compressor, 3},
+    {"_zlib_compressor_decisions", (DL_FUNC) &_zlib_compressor_decisions, 1},
+    {"_zlib_collect_compressor_output", (DL_FUNC) &_zlib_collect_compressor_output, 2},
+    {"_zlib_compress_many", (DL_FUNC) &_zlib_compress_many, 7},
+    {"_zlib_decompress_many", (DL_FUNC) &_zlib_decompress_many, 4},
+    {"_zlib_create_bgzf_compressor", (DL_FUNC) &_zlib_create_bgzf_compressor, 2},
+    {"_zlib_bgzf_compress", (DL_FUNC) &_zlib_bgzf_compress, 3},
+    {"_zlib_bgzf_decompress", (DL_FUNC) &_zlib_bgzf_decompress, 2},
+    {"_zlib_bgzf_read_file", (DL_FUNC) &_zlib_bgzf_read_file, 4},
+    {"_zlib_crc32_checksum", (DL_FUNC) &_zlib_crc32_checksum, 3},
+    {"_zlib_adler32_checksum", (DL_FUNC) &_zlib_adler32_checksum, 3},
+    {"_zlib_crc32_combine_checksums", (DL_FUNC) &_zlib_crc32_combine_checksums, 3},
+    {"_zlib_adler32_combine_checksums", (DL_FUNC) &_zlib_adler32_combine_checksums, 3},
+    {"_zlib_create_compressor", (DL_FUNC) &_zlib_create_compressor, 9},
     {"_zlib_compress_chunk", (DL_FUNC) &_zlib_compress_chunk, 2},
     {"_zlib_flush_compressor_buffer", (DL_FUNC) &_zlib_flush_compressor_buffer, 2},
+    {"_zlib_clone_compressor", (DL_FUNC) &_zlib_clone_compressor, 1},
+    {"_zlib_create_zlib_connection", (DL_FUNC) &_zlib_create_zlib_connection, 5},
     {"_zlib_zlib_constants", (DL_FUNC) &_zlib_zlib_constants, 0},
-    {"_zlib_create_decompressor", (DL_FUNC) &_zlib_create_decompressor, 1},
-    {"_zlib_decompress_chunk", (DL_FUNC) &_zlib_decompress_chunk, 2},
+    {"_zlib_create_decompressor", (DL_FUNC) &_zlib_create_decompressor, 3},
+    {"_zlib_decompress_chunk", (DL_FUNC) &_zlib_decompress_chunk, 3},
     {"_zlib_flush_decompressor_buffer", (DL_FUNC) &_zlib_flush_decompressor_buffer, 2},
+    {"_zlib_clone_decompressor", (DL_FUNC) &_zlib_clone_decompressor, 1},
+    {"_zlib_decompressor_members", (DL_FUNC) &_zlib_decompressor_members, 2},
+    {"_zlib_train_dictionary", (DL_FUNC) &_zlib_train_dictionary, 2},
+    {"_zlib_register_dictionary", (DL_FUNC) &_zlib_register_dictionary, 1},
+    {"_zlib_unregister_dictionary", (DL_FUNC) &_zlib_unregister_dictionary, 1},
+    {"_zlib_gzip_file", (DL_FUNC) &_zlib_gzip_file, 7},
+    {"_zlib_gunzip_file", (DL_FUNC) &_zlib_gunzip_file, 4},
+    {"_zlib_gzip_info", (DL_FUNC) &_zlib_gzip_info, 1},
+    {"_zlib_build_gzip_index", (DL_FUNC) &_zlib_build_gzip_index, 2},
+    {"_zlib_save_gzip_index", (DL_FUNC) &_zlib_save_gzip_index, 2},
+    {"_zlib_load_gzip_index", (DL_FUNC) &_zlib_load_gzip_index, 1},
+    {"_zlib_gz_read_range", (DL_FUNC) &_zlib_gz_read_range, 4},
+    {"_zlib_lazy_raw", (DL_FUNC) &_zlib_lazy_raw, 4},
+    {"_zlib_decompress_lazy", (DL_FUNC) &_zlib_decompress_lazy, 6},
+    {"_zlib_lazy_raw_info", (DL_FUNC) &_zlib_lazy_raw_info, 1},
+    {"_zlib_compress_buffer", (DL_FUNC) &_zlib_compress_buffer, 8},
+    {"_zlib_decompress_buffer", (DL_FUNC) &_zlib_decompress_buffer, 3},
+    {"_zlib_compress_parallel", (DL_FUNC) &_zlib_compress_parallel, 8},
+    {"_zlib_gunzip_parallel", (DL_FUNC) &_zlib_gunzip_parallel, 3},
+    {"_zlib_zlib_memory", (DL_FUNC) &_zlib_zlib_memory, 3},
+    {"_zlib_compress_object", (DL_FUNC) &_zlib_compress_object, 5},
+    {"_zlib_decompress_object", (DL_FUNC) &_zlib_decompress_object, 2},
+    {"_zlib_compressor_stats", (DL_FUNC) &_zlib_compressor_stats, 1},
+    {"_zlib_decompressor_stats", (DL_FUNC) &_zlib_decompressor_stats, 1},
+    {"_zlib_zlib_stats", (DL_FUNC) &_zlib_zlib_stats, 0},
     {"_zlib_validate_gzip_file", (DL_FUNC) &_zlib_validate_gzip_file, 1},
+    {"_zlib_validate_gzip_files", (DL_FUNC) &_zlib_validate_gzip_files, 2},
+    {"_zlib_ws_deflate_message", (DL_FUNC) &_zlib_ws_deflate_message, 3},
+    {"_zlib_ws_inflate_message", (DL_FUNC) &_zlib_ws_inflate_message, 4},
     {NULL, NULL, 0}
 };
 
+void init_lazy_raw(DllInfo* dll);
 RcppExport void R_init_zlib(DllInfo *dll) {
     R_registerRoutines(dll, NULL, CallEntries, NULL, NULL);
     R_useDynamicSymbols(dll, FALSE);
+    init_lazy_raw(dll);
 }
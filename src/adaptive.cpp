@@ -0,0 +1,272 @@
+#include <Rcpp.h>
+#include <zlib.h>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include "compressor.h"
+
+using namespace Rcpp;
+
+namespace {
+
+const size_t SAMPLE = 65536;      // At most this much of a chunk is analysed
+const size_t WINDOW = 4096;       // Larger chunks are sampled in windows spread over the chunk
+const size_t MIN_CHUNK = 1024;    // Smaller chunks keep the parameters in effect
+const size_t MIN_TIMED = 16384;   // Smaller chunks are too quick to time reliably
+const int HASH_BITS = 12;
+
+struct ContentStats {
+  double entropy = 0;
+  double match_rate = 0;
+  double run_rate = 0;
+};
+
+uint32_t read32(const uint8_t* p) {
+  uint32_t v;
+  std::memcpy(&v, p, 4);
+  return v;
+}
+
+// Order-0 entropy, the share of positions whose next 4 bytes were seen before within
+// the window (roughly what deflate's hash chains find) and the share of repeated bytes.
+ContentStats analyse(const uint8_t* in, size_t in_len) {
+  size_t windows = in_len <= SAMPLE ? 1 : SAMPLE / WINDOW;
+  size_t window = in_len <= SAMPLE ? in_len : WINDOW;
+  size_t stride = windows > 1 ? (in_len - window) / (windows - 1) : 0;
+
+  uint64_t counts[256] = {0};
+  std::vector<uint32_t> table(size_t(1) << HASH_BITS);
+  uint64_t positions = 0, matches = 0, runs = 0, total = 0;
+
+  for (size_t w = 0; w < windows; w++) {
+    const uint8_t* p = in + w * stride;
+    std::fill(table.begin(), table.end(), 0);  // Entries are position + 1 within the window
+    for (size_t i = 0; i < window; i++) {
+      counts[p[i]]++;
+      if (i > 0 && p[i] == p[i - 1]) runs++;
+      if (i + 4 <= window) {
+        uint32_t v = read32(p + i);
+        uint32_t h = (v * 2654435761u) >> (32 - HASH_BITS);
+        uint32_t prev = table[h];
+        if (prev && read32(p + prev - 1) == v) matches++;
+        table[h] = static_cast<uint32_t>(i + 1);
+        positions++;
+      }
+    }
+    total += window;
+  }
+
+  ContentStats stats;
+  for (int c = 0; c < 256; c++) {
+    if (counts[c]) {
+      double p = static_cast<double>(counts[c]) / total;
+      stats.entropy -= p * std::log2(p);
+    }
+  }
+  stats.match_rate = positions ? static_cast<double>(matches) / positions : 0;
+  stats.run_rate = total > 1 ? static_cast<double>(runs) / (total - 1) : 0;
+  return stats;
+}
+
+const char* strategy_name(int strategy) {
+  switch (strategy) {
+  case Z_FILTERED: return "filtered";
+  case Z_HUFFMAN_ONLY: return "huffman_only";
+  case Z_RLE: return "rle";
+  case Z_FIXED: return "fixed";
+  default: return "default";
+  }
+}
+
+}  // namespace
+
+int adapt_parameters(Compressor& compressor, const uint8_t* in, size_t in_len, size_t& produced) {
+  AdaptiveController& c = *compressor.adaptive;
+  uint64_t chunk = c.chunks++;
+  if (in_len < MIN_CHUNK) {
+    c.measuring = false;
+    return Z_OK;
+  }
+
+  ContentStats content = analyse(in, in_len);
+  int level = c.tuned_level;
+  int strategy = c.default_strategy;
+  const char* reason = "compressible";
+  if (content.entropy > 7.5 && content.match_rate < 0.01) {
+    level = 0;  // Already compressed or encrypted, store it
+    reason = "incompressible";
+  } else if (content.run_rate > 0.6) {
+    strategy = Z_RLE;
+    reason = "runs";
+  } else if (content.match_rate < 0.02) {
+    strategy = Z_HUFFMAN_ONLY;
+    reason = "few matches";
+  } else if (c.tuned) {
+    reason = c.tuned;
+  }
+  c.measuring = level == c.tuned_level && strategy == c.default_strategy;
+
+  if (level == c.level && strategy == c.strategy && !c.decisions.empty()) {
+    return Z_OK;
+  }
+
+  // deflateParams() compresses the pending input with the old parameters first and may
+  // need to write it out, so it gets room in the scratch buffer like deflate() does.
+  z_stream& strm = compressor.strm;
+  std::vector<uint8_t>& out = compressor.buffer;
+  strm.next_in = Z_NULL;
+  strm.avail_in = 0;
+  int ret;
+  while (true) {
+    if (produced == out.size()) {
+      out.resize(out.size() * 2);
+      compressor.stats.buffer_resizes++;
+    }
+    strm.next_out = out.data() + produced;
+    strm.avail_out = static_cast<uInt>(std::min<size_t>(out.size() - produced, UINT_MAX));
+    uInt avail_out = strm.avail_out;
+    ret = deflateParams(&strm, level, strategy);
+    produced += avail_out - strm.avail_out;
+    if (ret != Z_BUF_ERROR || strm.avail_out != 0) {
+      break;
+    }
+  }
+  if (ret == Z_BUF_ERROR) {
+    c.measuring = false;
+    return Z_OK;  // The switch did not happen, the next chunk tries again
+  }
+  if (ret != Z_OK) {
+    return ret;
+  }
+
+  c.level = level;
+  c.strategy = strategy;
+  if (reason == c.tuned) {
+    c.tuned = nullptr;
+  }
+  c.decisions.push_back(AdaptiveDecision{chunk, in_len, content.entropy, content.match_rate, content.run_rate,
+                                         c.mbps, level, strategy, reason});
+  return Z_OK;
+}
+
+void record_throughput(Compressor& compressor, size_t in_len, double seconds) {
+  AdaptiveController& c = *compressor.adaptive;
+  if (!c.measuring || in_len < MIN_TIMED || seconds <= 0) {
+    return;
+  }
+  double mbps = in_len / 1e6 / seconds;
+  c.mbps = c.samples++ == 0 ? mbps : 0.7 * c.mbps + 0.3 * mbps;
+
+  double required = c.target_mbps;
+  if (c.max_latency_ms > 0) {
+    required = std::max(required, in_len / 1e6 / (c.max_latency_ms / 1000));
+  }
+  if (required <= 0) {
+    return;
+  }
+
+  // Step one level at a time and measure afresh, with a dead band against oscillation
+  if (c.mbps < 0.9 * required && c.tuned_level > 1) {
+    c.tuned_level--;
+    c.tuned = "below target";
+    c.samples = 0;
+  } else if (c.mbps > 1.5 * required && c.tuned_level < c.max_level) {
+    c.tuned_level++;
+    c.tuned = "above target";
+    c.samples = 0;
+  }
+}
+
+//' Enable Adaptive Compression
+//'
+//' Let a compressor choose its compression level and strategy for every chunk. A sample of
+//' each chunk (at most 64 KiB) is analysed for its byte entropy, 4-byte repeats and byte runs:
+//' data that looks already compressed is stored, run-dominated data uses the RLE strategy and
+//' data with few repeats is Huffman coded only. Other data is compressed at a level that starts
+//' at the compressor's own and is lowered while the measured throughput misses the target,
+//' and raised back (never above the original level) once it is comfortably met. Parameters are
+//' switched with \code{deflateParams()} between chunks, so the output stays one valid stream.
+//' Usually enabled through \code{compressobj(adaptive = TRUE)}.
+//' @param compressorPtr An external pointer to an existing compressor object.
+//' @param target_mbps Minimum throughput to keep, in MB of input per second. 0 for none.
+//' @param max_latency_ms Maximum time to spend on one chunk, in milliseconds. 0 for none.
+//' @return NULL, invisibly.
+//' @examples
+//' compressor <- create_compressor(level = 9)
+//' enable_adaptive_compressor(compressor, target_mbps = 50)
+//' @export
+// [[Rcpp::export]]
+void enable_adaptive_compressor(SEXP compressorPtr, double target_mbps = 0, double max_latency_ms = 0) {
+  XPtr<Compressor> compressor(compressorPtr);
+  if (!compressor) {
+    stop("Invalid compressor object");
+  }
+  if (compressor->bgzf) {
+    stop("Adaptive compression is not supported for BGZF compressors");
+  }
+  if (target_mbps < 0 || max_latency_ms < 0) {
+    stop("target_mbps and max_latency_ms must not be negative");
+  }
+
+  std::unique_lock<std::mutex> lock = lock_stream(*compressor);
+  std::unique_ptr<AdaptiveController> c(new AdaptiveController());
+  c->max_level = compressor->level == Z_DEFAULT_COMPRESSION ? 6 : compressor->level;
+  c->default_strategy = compressor->strategy;
+  c->target_mbps = target_mbps;
+  c->max_latency_ms = max_latency_ms;
+  c->level = c->max_level;
+  c->strategy = c->default_strategy;
+  c->tuned_level = c->max_level;
+  compressor->adaptive = std::move(c);
+}
+
+//' Decisions of an Adaptive Compressor
+//'
+//' List the changes of compression parameters an adaptive compressor has made, including
+//' the content classification of its first chunk.
+//' @param compressorPtr An external pointer to a compressor in adaptive mode.
+//' @return A data frame with one row per change and the columns \code{chunk} (0-based index
+//' of the chunk the parameters were set for), \code{bytes}, \code{entropy} (bits per byte),
+//' \code{match_rate}, \code{run_rate}, \code{mbps} (smoothed throughput measured before the
+//' change, 0 if unknown), \code{level}, \code{strategy} and \code{reason}.
+//' @examples
+//' compressor <- create_compressor()
+//' enable_adaptive_compressor(compressor)
+//' invisible(compress_chunk(compressor, as.raw(sample(0:255, 1e5, replace = TRUE))))
+//' compressor_decisions(compressor)
+//' @export
+// [[Rcpp::export]]
+DataFrame compressor_decisions(SEXP compressorPtr) {
+  XPtr<Compressor> compressor(compressorPtr);
+  if (!compressor) {
+    stop("Invalid compressor object");
+  }
+  if (!compressor->adaptive) {
+    stop("The compressor is not in adaptive mode");
+  }
+
+  std::unique_lock<std::mutex> lock = lock_stream(*compressor);
+  const std::vector<AdaptiveDecision>& decisions = compressor->adaptive->decisions;
+  size_t n = decisions.size();
+  NumericVector chunk(n), bytes(n), entropy(n), match_rate(n), run_rate(n), mbps(n);
+  IntegerVector level(n);
+  CharacterVector strategy(n), reason(n);
+  for (size_t i = 0; i < n; i++) {
+    const AdaptiveDecision& d = decisions[i];
+    chunk[i] = static_cast<double>(d.chunk);
+    bytes[i] = static_cast<double>(d.bytes);
+    entropy[i] = d.entropy;
+    match_rate[i] = d.match_rate;
+    run_rate[i] = d.run_rate;
+    mbps[i] = d.mbps;
+    level[i] = d.level;
+    strategy[i] = strategy_name(d.strategy);
+    reason[i] = d.reason;
+  }
+
+  return DataFrame::create(Named("chunk") = chunk, Named("bytes") = bytes, Named("entropy") = entropy,
+                           Named("match_rate") = match_rate, Named("run_rate") = run_rate,
+                           Named("mbps") = mbps, Named("level") = level, Named("strategy") = strategy,
+                           Named("reason") = reason, Named("stringsAsFactors") = false);
+}
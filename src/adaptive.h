@@ -0,0 +1,51 @@
+#ifndef ZLIB_ADAPTIVE_H
+#define ZLIB_ADAPTIVE_H
+
+#include <zlib.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// One change of the deflate parameters made by the adaptive controller
+struct AdaptiveDecision {
+  uint64_t chunk;      // Index of the chunk the parameters were set for
+  size_t bytes;        // Size of that chunk
+  double entropy;      // Order-0 entropy of the sample, in bits per byte
+  double match_rate;   // Share of sampled positions starting a 4-byte repeat
+  double run_rate;     // Share of sampled bytes equal to their predecessor
+  double mbps;         // Smoothed throughput measured before the decision, 0 if unknown
+  int level;
+  int strategy;
+  const char* reason;
+};
+
+// State of a compressor in adaptive mode. The strategy follows the content of each chunk,
+// the level for compressible data follows the measured throughput.
+struct AdaptiveController {
+  int max_level = 6;         // Level requested by the user, never exceeded
+  int default_strategy = Z_DEFAULT_STRATEGY;
+  double target_mbps = 0;    // Minimum throughput to keep, 0 for none
+  double max_latency_ms = 0; // Maximum time per chunk, 0 for none
+
+  int level = 6;             // Parameters in effect
+  int strategy = Z_DEFAULT_STRATEGY;
+  int tuned_level = 6;       // Level for compressible data, lowered and raised by the throughput control
+  double mbps = 0;           // Smoothed throughput at tuned_level
+  int samples = 0;           // Chunks timed since tuned_level last changed
+  bool measuring = false;    // The last chunk was deflated at tuned_level
+  const char* tuned = nullptr;  // Why tuned_level changed, reported with the next decision
+  uint64_t chunks = 0;
+  std::vector<AdaptiveDecision> decisions;
+};
+
+struct Compressor;
+
+// Sample the chunk, choose the level and strategy for it and switch to them with
+// deflateParams(). Output flushed by the switch is written to the compressor's scratch
+// buffer from `produced` on. Returns Z_OK or the failing zlib return code.
+int adapt_parameters(Compressor& compressor, const uint8_t* in, size_t in_len, size_t& produced);
+
+// Feed the time spent deflating the last chunk back into the throughput control
+void record_throughput(Compressor& compressor, size_t in_len, double seconds);
+
+#endif // ZLIB_ADAPTIVE_H
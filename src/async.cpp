@@ -0,0 +1,215 @@
+#include <Rcpp.h>
+#include <zlib.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "compressor.h"
+
+using namespace Rcpp;
+
+// Background compression for a compressor in async mode. The main thread copies chunks
+// into a bounded queue; the worker thread owns the z_stream from then on, deflates the
+// chunks in order and appends the result to `output`, which the main thread collects.
+// The worker never touches the R API: errors are kept as a message and raised by the next
+// call on the main thread.
+struct AsyncPipeline {
+  struct Job {
+    std::vector<uint8_t> data;
+    int flush;
+  };
+
+  Compressor& compressor;
+  size_t queue_size;
+
+  std::mutex mutex;                 // Guards the members below
+  std::condition_variable changed;  // Signalled when a job is queued, taken or completed
+  std::deque<Job> jobs;
+  std::vector<uint8_t> output;      // Finished output not collected yet
+  bool busy = false;                // The worker is deflating a job
+  bool stopping = false;
+  std::string error;                // First failure of the worker, the stream is unusable after it
+
+  std::mutex stream_mutex;          // Held by the worker while it uses the stream and its stats
+  std::thread worker;
+
+  AsyncPipeline(Compressor& compressor, size_t queue_size)
+    : compressor(compressor), queue_size(queue_size), worker(&AsyncPipeline::run, this) {}
+
+  ~AsyncPipeline() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;  // Queued chunks are dropped with the compressor
+    }
+    changed.notify_all();
+    worker.join();
+  }
+
+  void run() {
+    while (true) {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return stopping || !jobs.empty(); });
+        if (stopping) {
+          return;
+        }
+        job = std::move(jobs.front());
+        jobs.pop_front();
+        busy = true;
+      }
+      changed.notify_all();  // Room in the queue
+
+      std::lock_guard<std::mutex> stream_lock(stream_mutex);
+      StatsScope scope(compressor.stats, compress_totals);
+      std::string failure;
+      size_t produced = 0;
+      try {
+        int ret = deflate_stream(compressor, job.data.data(), job.data.size(), job.flush, produced);
+        if (ret != Z_OK) {
+          failure = compressor.strm.msg ? compressor.strm.msg : zError(ret);
+        }
+      } catch (const std::exception& e) {
+        failure = e.what();
+      }
+      compressor.stats.memmove_bytes += job.data.size() + produced;  // Copies into and out of the pipeline
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (failure.empty()) {
+          output.insert(output.end(), compressor.buffer.begin(),
+                        compressor.buffer.begin() + static_cast<std::ptrdiff_t>(produced));
+        } else {
+          error = failure;
+          jobs.clear();
+        }
+      }
+      if (failure.empty() && job.flush == Z_FINISH) {
+        end_stream(compressor);
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        busy = false;
+      }
+      changed.notify_all();
+    }
+  }
+
+  // Wait on the main thread until `done` holds, checking for user interrupts meanwhile
+  template <typename Predicate>
+  void wait(std::unique_lock<std::mutex>& lock, Predicate done) {
+    while (!done()) {
+      if (changed.wait_for(lock, std::chrono::milliseconds(100)) == std::cv_status::timeout) {
+        checkUserInterrupt();
+      }
+    }
+  }
+
+  bool drained() const {
+    return (jobs.empty() && !busy) || !error.empty();
+  }
+
+  // Hand the finished output to R, or raise the worker's error. Called without the lock.
+  static RawVector result(const std::vector<uint8_t>& ready, const std::string& failure) {
+    if (!failure.empty()) {
+      Rcpp::Rcerr << "zlib error: " << failure << std::endl;
+      stop("Compression failed");
+    }
+    return RawVector(ready.begin(), ready.end());
+  }
+};
+
+void start_async_pipeline(Compressor& compressor, int queue_size) {
+  if (queue_size < 1) {
+    throw std::runtime_error("queue_size must be at least 1");
+  }
+  compressor.async = std::make_shared<AsyncPipeline>(compressor, static_cast<size_t>(queue_size));
+}
+
+RawVector async_compress_chunk(Compressor& compressor, const RawVector& input_chunk) {
+  AsyncPipeline& pipeline = *compressor.async;
+  std::vector<uint8_t> copy(input_chunk.begin(), input_chunk.end());  // The worker must not read R memory
+
+  std::vector<uint8_t> ready;
+  std::string failure;
+  {
+    std::unique_lock<std::mutex> lock(pipeline.mutex);
+    pipeline.wait(lock, [&]() { return pipeline.jobs.size() < pipeline.queue_size || !pipeline.error.empty(); });
+    if (pipeline.error.empty()) {
+      pipeline.jobs.push_back({std::move(copy), Z_NO_FLUSH});
+    }
+    ready.swap(pipeline.output);
+    failure = pipeline.error;
+  }
+  pipeline.changed.notify_all();
+  return AsyncPipeline::result(ready, failure);
+}
+
+RawVector async_flush(Compressor& compressor, int mode) {
+  AsyncPipeline& pipeline = *compressor.async;
+
+  std::vector<uint8_t> ready;
+  std::string failure;
+  {
+    std::unique_lock<std::mutex> lock(pipeline.mutex);
+    if (pipeline.error.empty()) {
+      pipeline.jobs.push_back({std::vector<uint8_t>(), mode});  // Not bounded, it is waited for below
+      pipeline.changed.notify_all();
+    }
+    pipeline.wait(lock, [&]() { return pipeline.drained(); });
+    ready.swap(pipeline.output);
+    failure = pipeline.error;
+  }
+  return AsyncPipeline::result(ready, failure);
+}
+
+std::unique_lock<std::mutex> lock_stream(Compressor& compressor) {
+  if (!compressor.async) {
+    return std::unique_lock<std::mutex>();
+  }
+  return std::unique_lock<std::mutex>(compressor.async->stream_mutex);
+}
+
+//' Collect the Output of an Async Compressor
+//'
+//' Return the compressed output that the background thread of a compressor created with
+//' \code{async = TRUE} has finished since the last call to \code{compress_chunk()},
+//' \code{flush_compressor_buffer()} or this function. Concatenating the results of all these
+//' calls in the order they were made gives the compressed stream.
+//' @param compressorPtr An external pointer to an existing compressor object.
+//' @param wait If \code{TRUE}, wait until all queued chunks are compressed first.
+//' @return A raw vector containing the compressed data, empty for a compressor that is not
+//' in async mode.
+//' @examples
+//' compressor <- create_compressor(wbits = 31, async = TRUE)
+//' compressed_data <- compress_chunk(compressor, charToRaw("Hello, World"))
+//' compressed_data <- c(compressed_data, collect_compressor_output(compressor, wait = TRUE))
+//' compressed_data <- c(compressed_data, flush_compressor_buffer(compressor))
+//' rawToChar(memDecompress(compressed_data, type = "gzip"))
+//' @export
+// [[Rcpp::export]]
+RawVector collect_compressor_output(SEXP compressorPtr, bool wait = false) {
+  XPtr<Compressor> compressor(compressorPtr);
+  if (!compressor) {
+    stop("Invalid compressor object");
+  }
+  if (!compressor->async) {
+    return RawVector();
+  }
+
+  AsyncPipeline& pipeline = *compressor->async;
+  std::vector<uint8_t> ready;
+  std::string failure;
+  {
+    std::unique_lock<std::mutex> lock(pipeline.mutex);
+    if (wait) {
+      pipeline.wait(lock, [&]() { return pipeline.drained(); });
+    }
+    ready.swap(pipeline.output);
+    failure = pipeline.error;
+  }
+  return AsyncPipeline::result(ready, failure);
+}
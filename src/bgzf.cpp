@@ -0,0 +1,469 @@
+#include <Rcpp.h>
+#include <zlib.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "compressor.h"
+#include "parallel.h"
+
+using namespace Rcpp;
+
+#ifdef _WIN32
+#define zlib_fseek _fseeki64
+typedef __int64 zlib_off_t;
+#else
+#define zlib_fseek fseeko
+typedef off_t zlib_off_t;
+#endif
+
+namespace {
+
+const size_t BGZF_BLOCK_INPUT = 0xff00;   // Input per block, keeps every block below 64 KiB
+const size_t BGZF_MAX_BLOCK = 65536;
+const size_t BGZF_HEADER = 18;            // Gzip header with the 6 byte BC extra field
+const uint8_t BGZF_EOF[28] = {0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff,
+                              0x06, 0x00, 0x42, 0x43, 0x02, 0x00, 0x1b, 0x00, 0x03, 0x00,
+                              0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+struct Span {
+  const uint8_t* data;
+  size_t size;
+};
+
+struct BgzfBlock {
+  size_t offset;      // Offset of the block in the compressed input
+  size_t size;        // Total block size (BSIZE + 1)
+  size_t header;      // Header size, including the extra field
+  uint32_t isize;     // Uncompressed size from the trailer
+  size_t out_offset;  // Offset of the block's data in the uncompressed output
+};
+
+void init_block_deflater(z_stream& strm, int level) {
+  strm.zalloc = Z_NULL;
+  strm.zfree = Z_NULL;
+  strm.opaque = Z_NULL;
+  if (deflateInit2(&strm, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::runtime_error("Failed to initialize compressor");
+  }
+}
+
+// Append one BGZF block for `in` to `out`. The BC extra field is set with deflateSetHeader
+// and its BSIZE is patched in once the compressed size is known (the header has no CRC).
+void deflate_block(z_stream& strm, const uint8_t* in, size_t len, std::vector<uint8_t>& out) {
+  unsigned char extra[6] = {'B', 'C', 2, 0, 0, 0};
+  gz_header head{};
+  head.os = 255;
+  head.extra = extra;
+  head.extra_len = sizeof(extra);
+
+  if (deflateReset(&strm) != Z_OK || deflateSetHeader(&strm, &head) != Z_OK) {
+    throw std::runtime_error("Failed to reset compressor");
+  }
+
+  size_t start = out.size();
+  out.resize(start + deflateBound(&strm, len));
+  strm.next_in = const_cast<Bytef*>(in);
+  strm.avail_in = static_cast<uInt>(len);
+  strm.next_out = out.data() + start;
+  strm.avail_out = static_cast<uInt>(out.size() - start);
+  if (deflate(&strm, Z_FINISH) != Z_STREAM_END) {
+    throw std::runtime_error("Compression failed");
+  }
+
+  size_t block_size = out.size() - start - strm.avail_out;
+  if (block_size > BGZF_MAX_BLOCK) {
+    throw std::runtime_error("BGZF block exceeds 64 KiB");
+  }
+  out.resize(start + block_size);
+  out[start + 16] = static_cast<uint8_t>((block_size - 1) & 0xff);
+  out[start + 17] = static_cast<uint8_t>((block_size - 1) >> 8);
+}
+
+// Compress a list of block inputs into consecutive BGZF blocks, on `threads` workers.
+// The serial path reuses `strm`; each parallel task owns a deflater for a run of blocks.
+// The CPU time of all workers is added to `stats`.
+void deflate_blocks(z_stream& strm, int level, int threads, const std::vector<Span>& spans,
+                    std::vector<uint8_t>& out, StreamStats& stats) {
+  threads = resolve_threads(threads);
+  if (threads == 1 || spans.size() < 2) {
+    uint64_t start = thread_cpu_ns();
+    for (const auto& span : spans) {
+      deflate_block(strm, span.data, span.size, out);
+    }
+    stats.cpu_ns += thread_cpu_ns() - start;
+    return;
+  }
+
+  size_t tasks = std::min(spans.size(), static_cast<size_t>(threads) * 4);
+  std::vector<std::vector<uint8_t>> parts(tasks);
+  std::atomic<uint64_t> cpu_ns{0};
+  parallel_for(tasks, threads, [&](size_t task) {
+    uint64_t start = thread_cpu_ns();
+    z_stream local{};
+    init_block_deflater(local, level);
+    try {
+      for (size_t i = task * spans.size() / tasks; i < (task + 1) * spans.size() / tasks; i++) {
+        deflate_block(local, spans[i].data, spans[i].size, parts[task]);
+      }
+    } catch (...) {
+      deflateEnd(&local);
+      throw;
+    }
+    deflateEnd(&local);
+    cpu_ns.fetch_add(thread_cpu_ns() - start, std::memory_order_relaxed);
+  });
+  stats.cpu_ns += cpu_ns.load();
+
+  for (const auto& part : parts) {
+    out.insert(out.end(), part.begin(), part.end());
+    stats.memmove_bytes += part.size();
+  }
+}
+
+// Parse the BGZF block header at `p`. Returns false if fewer than `avail` bytes hold the
+// whole block, throws if the data is not BGZF.
+bool parse_block(const uint8_t* p, size_t avail, size_t offset, BgzfBlock& block) {
+  if (avail < BGZF_HEADER) {
+    return false;
+  }
+  if (p[0] != 0x1f || p[1] != 0x8b || p[2] != Z_DEFLATED || !(p[3] & 4)) {
+    throw std::runtime_error("Not a BGZF block at offset " + std::to_string(offset));
+  }
+
+  size_t xlen = p[10] | (p[11] << 8);
+  if (avail < 12 + xlen) {
+    return false;
+  }
+
+  size_t bsize = 0;
+  for (size_t pos = 12; pos + 4 <= 12 + xlen;) {
+    size_t slen = p[pos + 2] | (p[pos + 3] << 8);
+    if (p[pos] == 'B' && p[pos + 1] == 'C' && slen == 2 && pos + 6 <= 12 + xlen) {
+      bsize = (p[pos + 4] | (p[pos + 5] << 8)) + 1;
+    }
+    pos += 4 + slen;
+  }
+  if (bsize == 0 || bsize < 12 + xlen + 8) {
+    throw std::runtime_error("Missing BGZF block size at offset " + std::to_string(offset));
+  }
+  if (avail < bsize) {
+    return false;
+  }
+
+  const uint8_t* trailer = p + bsize - 4;
+  block.offset = offset;
+  block.size = bsize;
+  block.header = 12 + xlen;
+  block.isize = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | (static_cast<uint32_t>(trailer[3]) << 24);
+  if (block.isize > BGZF_MAX_BLOCK) {
+    // The output is allocated from these sizes before any block is inflated
+    throw std::runtime_error("Corrupt BGZF block at offset " + std::to_string(offset));
+  }
+  return true;
+}
+
+void inflate_block(z_stream& strm, const uint8_t* base, const BgzfBlock& block, uint8_t* dest) {
+  if (inflateReset(&strm) != Z_OK) {
+    throw std::runtime_error("Failed to reset decompressor");
+  }
+  const uint8_t* p = base + block.offset;
+  strm.next_in = const_cast<Bytef*>(p + block.header);
+  strm.avail_in = static_cast<uInt>(block.size - block.header - 8);
+  strm.next_out = dest;
+  strm.avail_out = block.isize;
+
+  uint8_t dummy;
+  if (block.isize == 0) {
+    strm.next_out = &dummy;  // zlib needs a valid pointer even for empty output
+  }
+  int ret = inflate(&strm, Z_FINISH);
+  if (ret != Z_STREAM_END || strm.total_out != block.isize) {
+    throw std::runtime_error("Corrupt BGZF block at offset " + std::to_string(block.offset));
+  }
+
+  const uint8_t* trailer = p + block.size - 8;
+  uLong expected = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | (static_cast<uLong>(trailer[3]) << 24);
+  if (crc32(0L, dest, block.isize) != expected) {
+    throw std::runtime_error("CRC mismatch in BGZF block at offset " + std::to_string(block.offset));
+  }
+}
+
+// Inflate parsed blocks into `dest` (each at its out_offset), on `threads` workers.
+void inflate_blocks(const uint8_t* base, const std::vector<BgzfBlock>& blocks, uint8_t* dest, int threads) {
+  size_t tasks = std::min(blocks.size(), static_cast<size_t>(resolve_threads(threads)) * 4);
+  parallel_for(tasks, threads, [&](size_t task) {
+    z_stream strm{};
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    if (inflateInit2(&strm, -15) != Z_OK) {
+      throw std::runtime_error("Failed to initialize decompressor");
+    }
+    try {
+      for (size_t i = task * blocks.size() / tasks; i < (task + 1) * blocks.size() / tasks; i++) {
+        inflate_block(strm, base, blocks[i], dest + blocks[i].out_offset);
+      }
+    } catch (...) {
+      inflateEnd(&strm);
+      throw;
+    }
+    inflateEnd(&strm);
+  });
+}
+
+struct FileCloser {
+  FILE* file;
+  ~FileCloser() { if (file) fclose(file); }
+};
+
+}  // namespace
+
+size_t bgzf_deflate_into(Compressor& compressor, const uint8_t* in, size_t in_len, int flush) {
+  std::vector<uint8_t>& pending = compressor.pending;
+  std::vector<uint8_t>& out = compressor.buffer;
+  StreamStats& stats = compressor.stats;
+  std::vector<Span> spans;
+  size_t capacity = out.capacity();
+  out.clear();
+
+  // Top up a partially filled block first, then cut whole blocks straight from the input
+  size_t pos = 0;
+  if (!pending.empty()) {
+    pos = std::min(in_len, BGZF_BLOCK_INPUT - pending.size());
+    pending.insert(pending.end(), in, in + pos);
+    stats.memmove_bytes += pos;
+    if (pending.size() == BGZF_BLOCK_INPUT) {
+      spans.push_back({pending.data(), pending.size()});
+    }
+  }
+  for (; in_len - pos >= BGZF_BLOCK_INPUT; pos += BGZF_BLOCK_INPUT) {
+    spans.push_back({in + pos, BGZF_BLOCK_INPUT});
+  }
+
+  std::vector<uint8_t> tail(in + pos, in + in_len);
+  stats.memmove_bytes += tail.size();
+  if (flush != Z_NO_FLUSH) {
+    // Any flush closes the current block, Z_FINISH also appends the EOF marker
+    if (pending.size() == BGZF_BLOCK_INPUT || pending.empty()) {
+      if (!tail.empty()) spans.push_back({tail.data(), tail.size()});
+    } else {
+      pending.insert(pending.end(), tail.begin(), tail.end());
+      stats.memmove_bytes += tail.size();
+      tail.clear();
+      spans.push_back({pending.data(), pending.size()});
+    }
+  }
+
+  try {
+    deflate_blocks(compressor.strm, compressor.level, compressor.threads, spans, out, stats);
+  } catch (const std::exception& e) {
+    stop(e.what());
+  }
+
+  if (pending.size() == BGZF_BLOCK_INPUT || flush != Z_NO_FLUSH) {
+    pending.clear();
+  }
+  if (flush == Z_NO_FLUSH && !tail.empty()) {
+    pending.insert(pending.end(), tail.begin(), tail.end());
+    stats.memmove_bytes += tail.size();
+  }
+  if (flush == Z_FINISH) {
+    out.insert(out.end(), BGZF_EOF, BGZF_EOF + sizeof(BGZF_EOF));
+  }
+
+  // Every block is a complete gzip member written with a single Z_FINISH call
+  stats.calls += spans.size();
+  stats.flushes[Z_FINISH] += spans.size();
+  stats.stream_ends += spans.size();
+  stats.bytes_in += in_len;
+  stats.bytes_out += out.size();
+  if (out.capacity() > capacity) stats.buffer_resizes++;
+
+  return out.size();
+}
+
+//' Create a new BGZF compressor object
+//'
+//' Initialize a compressor that writes BGZF (blocked gzip) instead of a single gzip
+//' stream. The returned object works with \code{compress_chunk()} and
+//' \code{flush_compressor_buffer()}: input is cut into independent gzip members of at
+//' most 64 KiB, each carrying the BC extra field with its compressed size. Flushing closes
+//' the current block, \code{Z_FINISH} also appends the BGZF EOF marker block.
+//' @param level Compression level, integer between 0 and 9, or -1 for default.
+//' @param threads Number of threads used to compress whole blocks. 0 uses all available cores.
+//' @return A SEXP pointer to the new compressor object.
+//' @examples
+//' compressor <- create_bgzf_compressor(level = 6)
+//' compressed_data <- c(compress_chunk(compressor, charToRaw("Hello, World")),
+//'                      flush_compressor_buffer(compressor))
+//' @export
+// [[Rcpp::export]]
+SEXP create_bgzf_compressor(int level = -1, int threads = 1) {
+  Compressor* compressor = nullptr;  // Initialize to nullptr
+
+  try {
+    compressor = new Compressor();
+    compressor->bgzf = true;
+    compressor->level = level;
+    compressor->threads = threads;
+    init_block_deflater(compressor->strm, level);
+    compress_totals.streams.fetch_add(1, std::memory_order_relaxed);
+  } catch (const std::exception& e) {
+    delete compressor;
+    stop(e.what());
+  }
+
+  return XPtr<Compressor>(compressor, true);
+}
+
+//' Compress Data to BGZF
+//'
+//' Compress a raw vector into BGZF (blocked gzip) in a single step, compressing blocks
+//' in parallel. The output is a valid multi-member gzip file readable by any gzip tool.
+//' @param data A raw vector containing the uncompressed data.
+//' @param level Compression level, integer between 0 and 9, or -1 for default.
+//' @param threads Number of worker threads. 0 uses all available cores.
+//' @return A raw vector containing the BGZF data, terminated by the EOF marker block.
+//' @examples
+//' compressed_data <- bgzf_compress(charToRaw("Hello, World"))
+//' rawToChar(bgzf_decompress(compressed_data))
+//' @export
+// [[Rcpp::export]]
+RawVector bgzf_compress(const RawVector& data, int level = -1, int threads = 0) {
+  Compressor compressor;
+  compressor.bgzf = true;
+  compressor.level = level;
+  compressor.threads = threads;
+  try {
+    init_block_deflater(compressor.strm, level);
+  } catch (const std::exception& e) {
+    stop(e.what());
+  }
+
+  size_t produced = bgzf_deflate_into(compressor, data.begin(), static_cast<size_t>(data.size()), Z_FINISH);
+  return RawVector(compressor.buffer.begin(), compressor.buffer.begin() + static_cast<std::ptrdiff_t>(produced));
+}
+
+//' Decompress BGZF Data
+//'
+//' Decompress a raw vector of BGZF blocks. Block boundaries are found from the BC extra
+//' fields and the output size from the block trailers, so the result is allocated once and
+//' the blocks are inflated in parallel, each with its CRC-32 checked.
+//' @param data A raw vector containing BGZF data.
+//' @param threads Number of worker threads. 0 uses all available cores.
+//' @return A raw vector containing the decompressed data.
+//' @examples
+//' compressed_data <- bgzf_compress(charToRaw("Hello, World"))
+//' rawToChar(bgzf_decompress(compressed_data, threads = 2))
+//' @export
+// [[Rcpp::export]]
+RawVector bgzf_decompress(const RawVector& data, int threads = 0) {
+  const uint8_t* base = data.begin();
+  size_t size = static_cast<size_t>(data.size());
+  std::vector<BgzfBlock> blocks;
+  size_t offset = 0, total = 0;
+
+  try {
+    while (offset < size) {
+      BgzfBlock block;
+      if (!parse_block(base + offset, size - offset, offset, block)) {
+        throw std::runtime_error("Truncated BGZF block at offset " + std::to_string(offset));
+      }
+      block.out_offset = total;
+      total += block.isize;
+      offset += block.size;
+      blocks.push_back(block);
+    }
+
+    RawVector result(total);
+    inflate_blocks(base, blocks, result.begin(), threads);
+    return result;
+  } catch (const std::exception& e) {
+    stop(e.what());
+  }
+}
+
+//' Read from a BGZF File at a Virtual Offset
+//'
+//' Read uncompressed data from a BGZF file starting at a BGZF virtual offset, i.e.
+//' \code{compressed_block_offset * 65536 + offset_within_block}. Only the blocks that are
+//' needed are read, and they are inflated in parallel batches.
+//' @param file_path A string representing the path of the BGZF file.
+//' @param virtual_offset BGZF virtual offset to start reading at. Default is 0.
+//' @param length Number of uncompressed bytes to read, or -1 (default) to read to the end.
+//' @param threads Number of worker threads. 0 uses all available cores.
+//' @return A raw vector with up to \code{length} bytes.
+//' @examples
+//' temp_file <- tempfile(fileext = ".gz")
+//' writeBin(bgzf_compress(charToRaw(strrep("Hello, World ", 10000))), temp_file)
+//' rawToChar(bgzf_read_file(temp_file, virtual_offset = 6, length = 5))
+//' @export
+// [[Rcpp::export]]
+RawVector bgzf_read_file(const std::string& file_path, double virtual_offset = 0, double length = -1,
+                         int threads = 0) {
+  if (virtual_offset < 0) {
+    stop("virtual_offset must not be negative");
+  }
+
+  uint64_t voffset = static_cast<uint64_t>(virtual_offset);
+  zlib_off_t coffset = static_cast<zlib_off_t>(voffset >> 16);
+  size_t skip = static_cast<size_t>(voffset & 0xffff);
+  size_t wanted = length < 0 ? SIZE_MAX : static_cast<size_t>(length);
+
+  FILE* file = fopen(file_path.c_str(), "rb");
+  if (!file) {
+    stop("Failed to open file: " + file_path);
+  }
+  FileCloser closer{file};
+  if (zlib_fseek(file, coffset, SEEK_SET) != 0) {
+    stop("Failed to seek in file: " + file_path);
+  }
+
+  // Read batches of compressed blocks, inflate each batch in parallel and append
+  size_t batch_size = static_cast<size_t>(resolve_threads(threads)) * 16 * BGZF_MAX_BLOCK;
+  std::vector<uint8_t> in;
+  std::vector<uint8_t> out;
+  std::vector<uint8_t> result;
+  bool eof = false;
+
+  try {
+    while (!eof && result.size() < wanted) {
+      size_t have = in.size();
+      in.resize(have + batch_size);
+      size_t got = fread(in.data() + have, 1, batch_size, file);
+      if (ferror(file)) {
+        throw std::runtime_error("File read error: " + file_path);
+      }
+      in.resize(have + got);
+      eof = got == 0;
+
+      std::vector<BgzfBlock> blocks;
+      size_t offset = 0, total = 0;
+      BgzfBlock block;
+      while (parse_block(in.data() + offset, in.size() - offset, offset, block)) {
+        block.out_offset = total;
+        total += block.isize;
+        offset += block.size;
+        blocks.push_back(block);
+        if (wanted != SIZE_MAX && result.size() + total >= wanted + skip) break;  // Enough blocks for the request
+      }
+      if (eof && offset < in.size()) {
+        throw std::runtime_error("Truncated BGZF block in " + file_path);
+      }
+
+      out.resize(total);
+      inflate_blocks(in.data(), blocks, out.data(), threads);
+      in.erase(in.begin(), in.begin() + static_cast<std::ptrdiff_t>(offset));
+
+      size_t from = std::min(skip, out.size());
+      skip -= from;
+      size_t take = std::min(out.size() - from, wanted - result.size());
+      result.insert(result.end(), out.begin() + from, out.begin() + from + take);
+      checkUserInterrupt();
+    }
+  } catch (const std::exception& e) {
+    stop(e.what());
+  }
+
+  return RawVector(result.begin(), result.end());
+}
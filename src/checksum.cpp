@@ -0,0 +1,292 @@
+#include <Rcpp.h>
+#include <zlib.h>
+#include <algorithm>
+#include <climits>
+#include "parallel.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define ZLIB_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+using namespace Rcpp;
+
+namespace {
+
+const size_t PARALLEL_MIN = 32 << 20;  // Below this splitting costs more than it gains
+const size_t PARALLEL_PIECE = 8 << 20;
+const uLong ADLER_BASE = 65521;
+const size_t ADLER_NMAX = 5552;        // Largest n with 255n(n+1)/2 + (n+1)(BASE-1) < 2^32
+
+typedef uLong (*checksum_fn)(uLong, const uint8_t*, size_t);
+
+// Portable paths: zlib itself, fed in 32-bit windows
+uLong crc32_zlib(uLong crc, const uint8_t* data, size_t len) {
+  while (len > 0) {
+    uInt n = static_cast<uInt>(std::min<size_t>(len, UINT_MAX));
+    crc = crc32(crc, data, n);
+    data += n;
+    len -= n;
+  }
+  return crc;
+}
+
+uLong adler32_zlib(uLong adler, const uint8_t* data, size_t len) {
+  while (len > 0) {
+    uInt n = static_cast<uInt>(std::min<size_t>(len, UINT_MAX));
+    adler = adler32(adler, data, n);
+    data += n;
+    len -= n;
+  }
+  return adler;
+}
+
+#ifdef ZLIB_X86_SIMD
+
+// CRC-32 by carry-less multiplication folding (Intel, "Fast CRC Computation for Generic
+// Polynomials Using PCLMULQDQ"). Four 128-bit lanes are folded 64 bytes at a time, then
+// into one lane and reduced to 32 bits with a Barrett reduction. The constants are
+// x^(k) mod P(x) for the bit-reflected gzip polynomial.
+__attribute__((target("pclmul,sse4.1")))
+inline __m128i fold(__m128i x, __m128i k, __m128i next) {
+  __m128i lo = _mm_clmulepi64_si128(x, k, 0x00);
+  __m128i hi = _mm_clmulepi64_si128(x, k, 0x11);
+  return _mm_xor_si128(_mm_xor_si128(lo, hi), next);
+}
+
+__attribute__((target("pclmul,sse4.1")))
+uLong crc32_pclmul(uLong crc, const uint8_t* data, size_t len) {
+  if (len < 64) {
+    return crc32_zlib(crc, data, len);
+  }
+
+  const __m128i k1k2 = _mm_set_epi64x(0x1c6e41596, 0x154442bd4);
+  const __m128i k3k4 = _mm_set_epi64x(0x0ccaa009e, 0x1751997d0);
+  const __m128i k5 = _mm_set_epi64x(0, 0x163cd6124);
+  const __m128i poly = _mm_set_epi64x(0x1f7011641, 0x1db710641);
+  const __m128i mask32 = _mm_set_epi32(0, 0, 0, -1);
+
+  __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+  __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16));
+  __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32));
+  __m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(~crc & 0xffffffffUL)));
+  data += 64;
+  len -= 64;
+
+  for (; len >= 64; data += 64, len -= 64) {
+    x1 = fold(x1, k1k2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+    x2 = fold(x2, k1k2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16)));
+    x3 = fold(x3, k1k2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32)));
+    x4 = fold(x4, k1k2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48)));
+  }
+
+  x1 = fold(x1, k3k4, x2);
+  x1 = fold(x1, k3k4, x3);
+  x1 = fold(x1, k3k4, x4);
+  for (; len >= 16; data += 16, len -= 16) {
+    x1 = fold(x1, k3k4, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+  }
+
+  // 128 -> 64 bits, appending 32 zero bits, then 64 -> 32 bits
+  __m128i t = _mm_clmulepi64_si128(k3k4, x1, 0x01);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), t);
+  t = _mm_srli_si128(x1, 4);
+  x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5, 0x00), t);
+
+  // Barrett reduction
+  t = x1;
+  x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x10);
+  x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x00);
+  x1 = _mm_xor_si128(x1, t);
+  crc = ~static_cast<uint32_t>(_mm_extract_epi32(x1, 1)) & 0xffffffffUL;
+
+  return crc32_zlib(crc, data, len);
+}
+
+// Adler-32 on 32 byte blocks: the byte sums come from SAD against zero and the weighted
+// sums from multiply-adds with the descending tap weights. Both sums are reduced modulo
+// BASE every NMAX bytes.
+__attribute__((target("ssse3")))
+uLong adler32_ssse3(uLong adler, const uint8_t* data, size_t len) {
+  uint32_t s1 = adler & 0xffff;
+  uint32_t s2 = (adler >> 16) & 0xffff;
+  const size_t BLOCK = 32;
+  size_t blocks = len / BLOCK;
+  len -= blocks * BLOCK;
+
+  const __m128i tap1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17);
+  const __m128i tap2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi16(1);
+
+  while (blocks > 0) {
+    size_t n = std::min(blocks, ADLER_NMAX / BLOCK);
+    blocks -= n;
+
+    __m128i v_ps = _mm_set_epi32(0, 0, 0, static_cast<int>(s1 * n));
+    __m128i v_s2 = _mm_set_epi32(0, 0, 0, static_cast<int>(s2));
+    __m128i v_s1 = zero;
+    do {
+      const __m128i bytes1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+      const __m128i bytes2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16));
+      v_ps = _mm_add_epi32(v_ps, v_s1);
+      v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes1, zero));
+      v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_maddubs_epi16(bytes1, tap1), ones));
+      v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes2, zero));
+      v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_maddubs_epi16(bytes2, tap2), ones));
+      data += BLOCK;
+    } while (--n);
+    v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 5));
+
+    v_s1 = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, _MM_SHUFFLE(1, 0, 3, 2)));
+    s1 += static_cast<uint32_t>(_mm_cvtsi128_si32(v_s1));
+    v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, _MM_SHUFFLE(2, 3, 0, 1)));
+    v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, _MM_SHUFFLE(1, 0, 3, 2)));
+    s2 = static_cast<uint32_t>(_mm_cvtsi128_si32(v_s2));
+
+    s1 %= ADLER_BASE;
+    s2 %= ADLER_BASE;
+  }
+
+  return adler32_zlib(s1 | (static_cast<uLong>(s2) << 16), data, len);
+}
+
+#endif
+
+checksum_fn crc32_impl() {
+#ifdef ZLIB_X86_SIMD
+  static const checksum_fn fn = (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1"))
+                                ? crc32_pclmul : crc32_zlib;
+  return fn;
+#else
+  return crc32_zlib;
+#endif
+}
+
+checksum_fn adler32_impl() {
+#ifdef ZLIB_X86_SIMD
+  static const checksum_fn fn = __builtin_cpu_supports("ssse3") ? adler32_ssse3 : adler32_zlib;
+  return fn;
+#else
+  return adler32_zlib;
+#endif
+}
+
+uLong checked_value(double value, const char* name) {
+  if (!(value >= 0 && value <= 4294967295.0)) {
+    stop(std::string(name) + " must be between 0 and 2^32 - 1");
+  }
+  return static_cast<uLong>(value);
+}
+
+// Checksum `len` bytes, splitting large inputs into pieces that are checksummed in
+// parallel and joined in order with the combine function.
+uLong checksum(checksum_fn fn, uLong (*combine)(uLong, uLong, z_off_t), uLong init, uLong empty,
+               const uint8_t* data, size_t len, int threads) {
+  threads = resolve_threads(threads);
+  if (threads == 1 || len < PARALLEL_MIN) {
+    return fn(init, data, len);
+  }
+
+  size_t pieces = (len + PARALLEL_PIECE - 1) / PARALLEL_PIECE;
+  std::vector<uLong> values(pieces);
+  parallel_for(pieces, threads, [&](size_t i) {
+    size_t start = i * PARALLEL_PIECE;
+    values[i] = fn(i == 0 ? init : empty, data + start, std::min(PARALLEL_PIECE, len - start));
+  });
+
+  uLong value = values[0];
+  for (size_t i = 1; i < pieces; i++) {
+    size_t piece = std::min(PARALLEL_PIECE, len - i * PARALLEL_PIECE);
+    value = combine(value, values[i], static_cast<z_off_t>(piece));
+  }
+  return value;
+}
+
+}  // namespace
+
+//' Compute a CRC-32 Checksum
+//'
+//' Compute the CRC-32 checksum used by gzip. On x86 CPUs with \code{PCLMULQDQ} the data is
+//' folded 64 bytes at a time with carry-less multiplication, elsewhere zlib's
+//' \code{crc32()} is used. Vectors of 32 MiB and more are split across threads and the
+//' pieces are joined with \code{crc32_combine()}.
+//' @param x A raw vector.
+//' @param init The CRC-32 to continue from, e.g. the checksum of preceding data. Default is 0.
+//' @param threads Number of worker threads for large vectors. 0 uses all available cores.
+//' @return The CRC-32 as a number.
+//' @examples
+//' crc32(charToRaw("Hello, World"))
+//' crc32(charToRaw(", World"), crc32(charToRaw("Hello")))
+//' @export
+// [[Rcpp::export(name = "crc32")]]
+double crc32_checksum(const RawVector& x, double init = 0, int threads = 0) {
+  uLong value = checksum(crc32_impl(), crc32_combine, checked_value(init, "init"), 0,
+                         x.begin(), static_cast<size_t>(x.size()), threads);
+  return static_cast<double>(value);
+}
+
+//' Compute an Adler-32 Checksum
+//'
+//' Compute the Adler-32 checksum used by the zlib format. On x86 CPUs with SSSE3 the sums
+//' are accumulated 32 bytes at a time, elsewhere zlib's \code{adler32()} is used. Vectors
+//' of 32 MiB and more are split across threads and the pieces are joined with
+//' \code{adler32_combine()}.
+//' @param x A raw vector.
+//' @param init The Adler-32 to continue from, e.g. the checksum of preceding data. Default is 1.
+//' @param threads Number of worker threads for large vectors. 0 uses all available cores.
+//' @return The Adler-32 as a number.
+//' @examples
+//' adler32(charToRaw("Hello, World"))
+//' @export
+// [[Rcpp::export(name = "adler32")]]
+double adler32_checksum(const RawVector& x, double init = 1, int threads = 0) {
+  uLong value = checksum(adler32_impl(), adler32_combine, checked_value(init, "init"), 1,
+                         x.begin(), static_cast<size_t>(x.size()), threads);
+  return static_cast<double>(value);
+}
+
+//' Combine Two CRC-32 Checksums
+//'
+//' Compute the CRC-32 of the concatenation of two byte sequences from their checksums and
+//' the length of the second one.
+//' @param crc1 CRC-32 of the first sequence.
+//' @param crc2 CRC-32 of the second sequence.
+//' @param len2 Length of the second sequence in bytes.
+//' @return The CRC-32 of both sequences as a number.
+//' @examples
+//' first <- charToRaw("Hello, ")
+//' second <- charToRaw("World")
+//' crc32_combine(crc32(first), crc32(second), length(second)) == crc32(c(first, second))
+//' @export
+// [[Rcpp::export(name = "crc32_combine")]]
+double crc32_combine_checksums(double crc1, double crc2, double len2) {
+  if (!(len2 >= 0 && len2 <= static_cast<double>(std::numeric_limits<z_off_t>::max()))) {
+    stop("Invalid length");
+  }
+  return static_cast<double>(crc32_combine(checked_value(crc1, "crc1"), checked_value(crc2, "crc2"),
+                                           static_cast<z_off_t>(len2)));
+}
+
+//' Combine Two Adler-32 Checksums
+//'
+//' Compute the Adler-32 of the concatenation of two byte sequences from their checksums and
+//' the length of the second one.
+//' @param adler1 Adler-32 of the first sequence.
+//' @param adler2 Adler-32 of the second sequence.
+//' @param len2 Length of the second sequence in bytes.
+//' @return The Adler-32 of both sequences as a number.
+//' @examples
+//' first <- charToRaw("Hello, ")
+//' second <- charToRaw("World")
+//' adler32_combine(adler32(first), adler32(second), length(second)) == adler32(c(first, second))
+//' @export
+// [[Rcpp::export(name = "adler32_combine")]]
+double adler32_combine_checksums(double adler1, double adler2, double len2) {
+  if (!(len2 >= 0 && len2 <= static_cast<double>(std::numeric_limits<z_off_t>::max()))) {
+    stop("Invalid length");
+  }
+  return static_cast<double>(adler32_combine(checked_value(adler1, "adler1"), checked_value(adler2, "adler2"),
+                                             static_cast<z_off_t>(len2)));
+}
@@ -1,13 +1,111 @@
 #include <Rcpp.h>
 #include <zlib.h>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include "compressor.h"
+#include "pool.h"
 
 using namespace Rcpp;
 
-struct Compressor {
-  z_stream strm{};
-  std::vector<uint8_t> buffer;
-  RawVector zdict;
-};
+int deflate_stream(Compressor& compressor, const uint8_t* in, size_t in_len, int flush, size_t& produced) {
+  z_stream& strm = compressor.strm;
+  std::vector<uint8_t>& out = compressor.buffer;
+  StreamStats& stats = compressor.stats;
+
+  // Size the scratch space from deflateBound so a chunk normally needs a single pass
+  size_t wanted = std::max<size_t>(deflateBound(&strm, static_cast<uLong>(std::min<size_t>(in_len, UINT_MAX))), 16384);
+  if (out.size() < wanted) {
+    out.resize(wanted);
+    stats.buffer_resizes++;
+  }
+
+  size_t consumed = 0;
+  produced = 0;
+  int ret;
+
+  std::chrono::steady_clock::time_point start;
+  if (compressor.adaptive && in_len > 0) {
+    ret = adapt_parameters(compressor, in, in_len, produced);
+    if (ret != Z_OK) {
+      return ret;
+    }
+    start = std::chrono::steady_clock::now();
+  }
+
+  while (true) {
+    if (produced == out.size()) {
+      out.resize(out.size() * 2);  // Double the output buffer size if needed.
+      stats.buffer_resizes++;
+    }
+
+    // avail_in / avail_out are 32-bit, so long vectors are fed in windows. The final
+    // flush mode is only requested once the last window is in avail_in.
+    size_t remaining = in_len - consumed;
+    int mode = remaining > UINT_MAX ? Z_NO_FLUSH : flush;
+    strm.next_in = const_cast<Bytef*>(in + consumed);
+    strm.avail_in = static_cast<uInt>(std::min<size_t>(remaining, UINT_MAX));
+    strm.next_out = out.data() + produced;
+    strm.avail_out = static_cast<uInt>(std::min<size_t>(out.size() - produced, UINT_MAX));
+    uInt avail_in = strm.avail_in;
+    uInt avail_out = strm.avail_out;
+
+    ret = deflate(&strm, mode);
+    consumed += avail_in - strm.avail_in;
+    produced += avail_out - strm.avail_out;
+    stats.calls++;
+    if (mode >= Z_NO_FLUSH && mode <= Z_TREES) stats.flushes[mode]++;
+
+    if (ret < 0 && ret != Z_BUF_ERROR) {
+      break;  // Reported by the caller
+    }
+
+    if (consumed < in_len || strm.avail_out == 0) {
+      continue;  // More input to feed, or more output pending
+    }
+    if (flush != Z_FINISH || ret == Z_STREAM_END || ret == Z_BUF_ERROR) {
+      ret = Z_OK;
+      break;
+    }
+  }
+
+  stats.bytes_in += consumed;
+  stats.bytes_out += produced;
+  strm.next_in = Z_NULL;  // Do not keep pointers into R memory between calls
+  strm.avail_in = 0;
+
+  if (compressor.adaptive && in_len > 0 && ret == Z_OK) {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    record_throughput(compressor, in_len, elapsed.count());
+  }
+  return ret;
+}
+
+size_t deflate_into(Compressor& compressor, const uint8_t* in, size_t in_len, int flush) {
+  if (compressor.bgzf) {
+    return bgzf_deflate_into(compressor, in, in_len, flush);
+  }
+
+  size_t produced = 0;
+  int ret = deflate_stream(compressor, in, in_len, flush, produced);
+  if (ret != Z_OK) {
+    z_stream& strm = compressor.strm;
+    Rcpp::Rcerr << "zlib error: " << (strm.msg ? strm.msg : zError(ret)) << std::endl;  // More detailed error message
+    stop("Compression failed");
+  }
+  return produced;
+}
+
+void end_stream(Compressor& compressor) {
+  deflateReset(&compressor.strm);
+  if (compressor.header) {
+    set_gzip_header(compressor.strm, *compressor.header);
+  }
+  if (!compressor.bgzf) compressor.stats.stream_ends++;  // BGZF counts its blocks
+  if (compressor.buffer.capacity() > (1 << 20)) {
+    std::vector<uint8_t>().swap(compressor.buffer);  // Release large scratch space once a stream is complete
+  }
+}
 
 //' Create a new compressor object
 //'
@@ -18,43 +116,50 @@ struct Compressor {
 //' @param memLevel Memory level for internal compression state.
 //' @param strategy Compression strategy.
 //' @param zdict Optional predefined compression dictionary as a raw vector.
+//' @param async If \code{TRUE}, chunks are compressed by a background thread. \code{compress_chunk()}
+//' then only queues a copy of the chunk and returns the output that is already finished,
+//' \code{collect_compressor_output()} returns further finished output and
+//' \code{flush_compressor_buffer()} waits for the queue to drain.
+//' @param queue_size Maximum number of chunks waiting for the background thread in async mode.
+//' \code{compress_chunk()} blocks while the queue is full.
+//' @param header Optional list of gzip header fields, for gzip streams only: \code{name} and
+//' \code{comment} (strings), \code{mtime} (seconds since the epoch or \code{POSIXct}),
+//' \code{os} (integer), \code{extra} (raw vector) and \code{text} (logical).
 //' @return A SEXP pointer to the new compressor object.
 //' @examples
 //' compressor <- create_compressor(level = 6, memLevel = 8)
 //' @export
 // [[Rcpp::export]]
 SEXP create_compressor(int level = -1, int method = 8, int wbits = 15,
-                       int memLevel = 8, int strategy = 0, Nullable<RawVector> zdict = R_NilValue) {
+                       int memLevel = 8, int strategy = 0, Nullable<RawVector> zdict = R_NilValue,
+                       bool async = false, int queue_size = 4, Nullable<List> header = R_NilValue) {
 
-  Compressor* compressor = nullptr;  // Initialize to nullptr
+  // Streams come from the pool and go back to it when the object is garbage collected
+  PooledCompressor compressor = acquire_compressor(level, method, wbits, memLevel, strategy);
+  compress_totals.streams.fetch_add(1, std::memory_order_relaxed);
 
-  try {
-    compressor = new Compressor();
-
-    compressor->strm.zalloc = Z_NULL;
-    compressor->strm.zfree = Z_NULL;
-    compressor->strm.opaque = Z_NULL;
-
-    // Initialize compressor
-    if (deflateInit2(&compressor->strm, level, method, wbits, memLevel, strategy) != Z_OK) {
-      throw std::runtime_error("Failed to initialize compressor");
+  // Set the compression dictionary if provided
+  if (zdict.isNotNull()) {
+    RawVector dictVec(zdict);
+    compressor->zdict.assign(dictVec.begin(), dictVec.end());
+    if (deflateSetDictionary(&compressor->strm, &dictVec[0], dictVec.size()) != Z_OK) {
+      throw std::runtime_error("Failed to set dictionary");
     }
+  }
 
-    // Set the compression dictionary if provided
-    if (zdict.isNotNull()) {
-      RawVector dictVec(zdict);
-      compressor->zdict = dictVec;
-      if (deflateSetDictionary(&compressor->strm, &dictVec[0], dictVec.size()) != Z_OK) {
-        throw std::runtime_error("Failed to set dictionary");
-      }
+  if (header.isNotNull()) {
+    compressor->header.reset(new GzipHeader());
+    read_gzip_header(List(header), *compressor->header);
+    if (set_gzip_header(compressor->strm, *compressor->header) != Z_OK) {
+      throw std::runtime_error("A gzip header can only be set for gzip streams (wbits 24..31)");
     }
+  }
 
-  } catch (...) {
-    delete compressor;  // Safely delete if an exception is thrown
-    throw;  // Re-throw the caught exception
+  if (async) {
+    start_async_pipeline(*compressor, queue_size);
   }
 
-  return XPtr<Compressor>(compressor, true);  // Now it's safe to return
+  return XPtr<Compressor, PreserveStorage, release_compressor>(compressor.release(), true);
 }
 
 
@@ -88,35 +193,13 @@ RawVector compress_chunk(SEXP compressorPtr, const RawVector& input_chunk) {
     stop("Invalid compressor object");
   }
 
-  compressor->strm.avail_in = input_chunk.size();
-  compressor->strm.next_in = (Bytef*)input_chunk.begin();
-
-  std::vector<uint8_t> out(input_chunk.size() * 2);  // Initial estimate
-  compressor->strm.avail_out = out.size();
-  compressor->strm.next_out = out.data();
-
-  int ret;
-
-  do {
-    ret = deflate(&compressor->strm, Z_NO_FLUSH);  // Change to Z_NO_FLUSH
-
-    if (ret < 0) {
-      Rcpp::Rcerr << "zlib error: " << zError(ret) << std::endl;  // More detailed error message
-      stop("Compression failed");
-    }
-
-    if (compressor->strm.avail_out == 0) {
-      // Double the output buffer size if needed.
-      size_t oldSize = out.size();
-      out.resize(oldSize * 2);
-      compressor->strm.next_out = out.data() + oldSize;
-      compressor->strm.avail_out = oldSize;
-    }
-
-  } while (compressor->strm.avail_in > 0);
+  if (compressor->async) {
+    return async_compress_chunk(*compressor, input_chunk);
+  }
 
-  auto actual_out_diff = out.size() - compressor->strm.avail_out;
-  return {out.begin(), out.begin() + actual_out_diff};
+  StatsScope scope(compressor->stats, compress_totals, !compressor->bgzf);
+  size_t produced = deflate_into(*compressor, input_chunk.begin(), static_cast<size_t>(input_chunk.size()), Z_NO_FLUSH);
+  return RawVector(compressor->buffer.begin(), compressor->buffer.begin() + static_cast<std::ptrdiff_t>(produced));
 }
 
 
@@ -139,39 +222,67 @@ RawVector flush_compressor_buffer(SEXP compressorPtr, int mode = 4) {
     stop("Invalid compressor object");
   }
 
-  compressor->strm.avail_in = 0; // No input data since we're just flushing
-  compressor->strm.next_in = Z_NULL;
-
-  size_t initialSize = 512;  // Starting buffer size
-  std::vector<uint8_t> out(initialSize);
-  compressor->strm.avail_out = initialSize;
-  compressor->strm.next_out = out.data();
+  if (compressor->async) {
+    return async_flush(*compressor, mode);
+  }
 
-  int ret;
- do {
-     ret = deflate(&compressor->strm, mode);
+  StatsScope scope(compressor->stats, compress_totals, !compressor->bgzf);
+  size_t produced = deflate_into(*compressor, nullptr, 0, mode);
+  RawVector result(compressor->buffer.begin(), compressor->buffer.begin() + static_cast<std::ptrdiff_t>(produced));
 
-     if (ret < 0 && ret != Z_BUF_ERROR) {
-       Rcpp::Rcerr << "zlib error: " << (compressor->strm.msg ? compressor->strm.msg : "Unknown error") << std::endl;
-       stop("Flush failed");
-     }
+  if (mode == Z_FINISH) {
+    end_stream(*compressor);
+  }
 
-     if (compressor->strm.avail_out == 0 || ret == Z_BUF_ERROR) {
-       // Double the buffer size if it's all used up
-       size_t oldSize = out.size();
-       out.resize(oldSize * 2);
-       compressor->strm.next_out = out.data() + oldSize;
-       compressor->strm.avail_out = oldSize;
-     }
+  return result;
+}
 
-   } while (ret == Z_BUF_ERROR || (mode == Z_FINISH && ret != Z_STREAM_END)); // keep resizing until flush is complete or another error occurs
+//' Clone a Compressor Object
+//'
+//' Copy the complete state of a compressor with \code{deflateCopy}, including the history
+//' window and the input it holds back. The clone continues the stream exactly like the
+//' original would: the output of both is valid after the output the original returned up to
+//' the point of cloning. Used by \code{compressor_template()} to compress a shared prefix
+//' once and fork a copy for every message.
+//' @param compressorPtr An external pointer to an existing compressor object. BGZF and async
+//' compressors cannot be cloned.
+//' @return A SEXP pointer to the new compressor object.
+//' @examples
+//' compressor <- create_compressor(wbits = 31)
+//' head <- compress_chunk(compressor, charToRaw("shared envelope;"))
+//' fork <- clone_compressor(compressor)
+//' message <- c(head, compress_chunk(fork, charToRaw("message")), flush_compressor_buffer(fork))
+//' rawToChar(memDecompress(message, type = "gzip"))
+//' @export
+// [[Rcpp::export]]
+SEXP clone_compressor(SEXP compressorPtr) {
+  XPtr<Compressor> source(compressorPtr);
+  if (!source) {
+    stop("Invalid compressor object");
+  }
+  if (source->bgzf || source->async) {
+    stop("BGZF and async compressors cannot be cloned");
+  }
 
-  if (mode == Z_FINISH && ret == Z_STREAM_END) {
-    deflateReset(&compressor->strm);
-    compressor->buffer.clear(); // Clear the internal buffer as we've flushed it
+  // The copy allocates with the source's zalloc, so a pooled source gives a pooled clone
+  PooledCompressor clone(new Compressor());
+  if (deflateCopy(&clone->strm, &source->strm) != Z_OK) {
+    stop("Failed to clone compressor");
+  }
+  compress_totals.streams.fetch_add(1, std::memory_order_relaxed);
+  clone->level = source->level;
+  clone->wbits = source->wbits;
+  clone->memLevel = source->memLevel;
+  clone->strategy = source->strategy;
+  clone->pooled = source->pooled;
+  clone->zdict = source->zdict;
+  if (source->header) {
+    clone->header.reset(new GzipHeader(*source->header));
+    set_gzip_header(clone->strm, *clone->header);  // The copied state still points at the source's header
+  }
+  if (source->adaptive) {
+    clone->adaptive.reset(new AdaptiveController(*source->adaptive));
   }
 
-  auto actual_out_diff = out.size() - compressor->strm.avail_out;
-  return {out.begin(), out.begin() + actual_out_diff};
+  return XPtr<Compressor, PreserveStorage, release_compressor>(clone.release(), true);
 }
-
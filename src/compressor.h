@@ -0,0 +1,71 @@
+#ifndef ZLIB_COMPRESSOR_H
+#define ZLIB_COMPRESSOR_H
+
+#include <Rcpp.h>
+#include <zlib.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "adaptive.h"
+#include "gzip.h"
+#include "stats.h"
+
+struct AsyncPipeline;  // Defined in async.cpp
+
+struct Compressor {
+  z_stream strm{};
+  std::vector<uint8_t> buffer;  // Persistent output scratch space, reused across calls
+  std::vector<uint8_t> zdict;
+  std::unique_ptr<GzipHeader> header;  // Written again at the start of every gzip stream
+  StreamStats stats;
+  int level = Z_DEFAULT_COMPRESSION;  // Parameters the stream was created with
+  int wbits = MAX_WBITS;
+  int memLevel = 8;
+  int strategy = Z_DEFAULT_STRATEGY;
+  bool pooled = false;  // Allocated on the arena and returned to the stream pool, see pool.cpp
+
+  // BGZF mode: input is cut into independent gzip members of at most 64 KiB
+  bool bgzf = false;
+  int threads = 1;
+  std::vector<uint8_t> pending;  // Input not yet filling a whole BGZF block
+
+  // Adaptive mode: level and strategy are chosen per chunk, see adaptive.cpp
+  std::unique_ptr<AdaptiveController> adaptive;
+
+  // Async mode: chunks are queued and deflated by a worker thread that owns the stream
+  std::shared_ptr<AsyncPipeline> async;
+
+  ~Compressor() {
+    async.reset();  // Joins the worker before the stream goes away
+    deflateEnd(&strm);
+  }
+};
+
+// Core of deflate_into() for plain (non-BGZF) streams. Errors are returned as the zlib
+// return code instead of being raised, so it is safe to call outside the main R thread.
+// Returns Z_OK on success and stores the number of bytes written in `produced`.
+int deflate_stream(Compressor& compressor, const uint8_t* in, size_t in_len, int flush, size_t& produced);
+
+// Deflate `in_len` bytes from `in` with the given flush mode into the compressor's scratch
+// buffer, growing it as needed. Returns the number of bytes written to the scratch buffer.
+size_t deflate_into(Compressor& compressor, const uint8_t* in, size_t in_len, int flush);
+
+// BGZF counterpart of deflate_into(), used automatically for compressors in BGZF mode.
+// Defined in bgzf.cpp.
+size_t bgzf_deflate_into(Compressor& compressor, const uint8_t* in, size_t in_len, int flush);
+
+// Reset the stream after Z_FINISH so the compressor can start the next one.
+void end_stream(Compressor& compressor);
+
+// Async mode, defined in async.cpp. compress_chunk() / flush_compressor_buffer() hand
+// over to these when the compressor has a pipeline.
+void start_async_pipeline(Compressor& compressor, int queue_size);
+Rcpp::RawVector async_compress_chunk(Compressor& compressor, const Rcpp::RawVector& input_chunk);
+Rcpp::RawVector async_flush(Compressor& compressor, int mode);
+// Keep the worker of an async compressor away from the stream, e.g. to read its stats
+// between two chunks. Does not lock anything for other compressors.
+std::unique_lock<std::mutex> lock_stream(Compressor& compressor);
+
+#endif // ZLIB_COMPRESSOR_H
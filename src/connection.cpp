@@ -0,0 +1,254 @@
+#include <Rcpp.h>
+#include <zlib.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include "compressor.h"
+#include "decompressor.h"
+#include "pool.h"
+
+// R_ext/Connections.h names members of struct Rconn `class` and `private`
+#define class class_name
+#define private private_ptr
+#include <R_ext/Connections.h>
+#undef class
+#undef private
+
+#if R_CONNECTIONS_VERSION != 1
+#error "Unsupported version of the R connections API"
+#endif
+
+using namespace Rcpp;
+
+namespace {
+
+// State of a zlib connection. Reading inflates the inner connection's bytes through a
+// Decompressor, writing stages input and deflates it through a Compressor, so both
+// directions keep at most a few buffers of `buffer_size` bytes in memory.
+struct ZlibConnection {
+  SEXP inner_sexp = R_NilValue;  // Preserved while the connection exists
+  Rconnection inner = nullptr;
+  size_t buffer_size = 0;
+  PooledDecompressor decompressor;  // Reading
+  PooledCompressor compressor;      // Writing
+
+  std::vector<uint8_t> input;  // Compressed input (reading) or input staged for deflate (writing)
+  size_t input_pos = 0;
+  size_t input_len = 0;
+  std::vector<uint8_t> output;  // Inflated data not returned yet
+  size_t output_pos = 0;
+  size_t output_len = 0;
+  bool inner_eof = false;
+};
+
+ZlibConnection& state(Rconnection con) {
+  return *static_cast<ZlibConnection*>(con->private_ptr);
+}
+
+// Inflate the next piece of data into `output`. Returns false once the inner connection
+// is exhausted and zlib has nothing left to give; truncated streams simply end there.
+bool refill(ZlibConnection& z) {
+  z.output_pos = 0;
+  z.output_len = 0;
+  while (true) {
+    {
+      StatsScope scope(z.decompressor->stats, decompress_totals);
+      z.input_pos += inflate_into(*z.decompressor, z.input.data() + z.input_pos, z.input_len - z.input_pos,
+                                  z.output, z.output_len, z.buffer_size);
+    }
+    if (z.output_len > 0) {
+      return true;
+    }
+    if (z.inner_eof) {
+      return false;
+    }
+    z.input_len = R_ReadConnection(z.inner, z.input.data(), z.buffer_size);
+    z.input_pos = 0;
+    z.inner_eof = z.input_len == 0;  // One more pass drains what zlib still holds
+  }
+}
+
+// Deflate `len` bytes and write the result to the inner connection
+void deflate_and_write(ZlibConnection& z, const uint8_t* in, size_t len, int flush) {
+  size_t produced;
+  {
+    StatsScope scope(z.compressor->stats, compress_totals);
+    produced = deflate_into(*z.compressor, in, len, flush);
+  }
+  if (produced > 0 && R_WriteConnection(z.inner, z.compressor->buffer.data(), produced) != produced) {
+    throw std::runtime_error("Failed to write to the underlying connection");
+  }
+}
+
+// The callbacks are called from R's C code, so C++ exceptions must not escape them. The
+// message is kept and raised with Rf_error() once no C++ object is left on the frame.
+size_t zlib_read(void* ptr, size_t size, size_t nitems, Rconnection con) {
+  ZlibConnection& z = state(con);
+  size_t wanted = size * nitems;
+  size_t done = 0;
+  char message[512] = "";
+  try {
+    while (done < wanted) {
+      if (z.output_pos == z.output_len && !refill(z)) {
+        break;
+      }
+      size_t n = std::min(wanted - done, z.output_len - z.output_pos);
+      std::memcpy(static_cast<uint8_t*>(ptr) + done, z.output.data() + z.output_pos, n);
+      z.output_pos += n;
+      done += n;
+    }
+  } catch (const std::exception& e) {
+    std::snprintf(message, sizeof(message), "%s", e.what());
+  }
+  if (message[0]) {
+    Rf_error("%s", message);
+  }
+  return size == 0 ? 0 : done / size;
+}
+
+int zlib_fgetc(Rconnection con) {
+  ZlibConnection& z = state(con);
+  if (z.output_pos < z.output_len) {
+    return z.output[z.output_pos++];  // readLines() reads one character at a time
+  }
+  unsigned char c;
+  return zlib_read(&c, 1, 1, con) == 1 ? c : R_EOF;
+}
+
+size_t zlib_write(const void* ptr, size_t size, size_t nitems, Rconnection con) {
+  ZlibConnection& z = state(con);
+  const uint8_t* in = static_cast<const uint8_t*>(ptr);
+  size_t len = size * nitems;
+  char message[512] = "";
+  try {
+    // Small writes, e.g. one per line from writeLines(), are staged into a whole buffer
+    if (z.input_len + len > z.buffer_size && z.input_len > 0) {
+      deflate_and_write(z, z.input.data(), z.input_len, Z_NO_FLUSH);
+      z.input_len = 0;
+    }
+    if (len >= z.buffer_size) {
+      deflate_and_write(z, in, len, Z_NO_FLUSH);
+    } else {
+      std::memcpy(z.input.data() + z.input_len, in, len);
+      z.input_len += len;
+    }
+  } catch (const std::exception& e) {
+    std::snprintf(message, sizeof(message), "%s", e.what());
+  }
+  if (message[0]) {
+    Rf_error("%s", message);
+  }
+  return nitems;
+}
+
+void zlib_close(Rconnection con) {
+  ZlibConnection& z = state(con);
+  char message[512] = "";
+  if (z.compressor) {
+    try {
+      deflate_and_write(z, z.input.data(), z.input_len, Z_FINISH);
+      z.input_len = 0;
+      z.compressor->stats.stream_ends++;
+    } catch (const std::exception& e) {
+      std::snprintf(message, sizeof(message), "%s", e.what());
+    }
+  }
+  if (z.inner->isopen) {
+    z.inner->close(z.inner);  // Like gzcon(), closing the connection closes the inner one
+    z.inner->isopen = FALSE;
+  }
+  con->isopen = FALSE;
+  if (message[0]) {
+    Rf_error("%s", message);
+  }
+}
+
+void zlib_destroy(Rconnection con) {
+  ZlibConnection* z = static_cast<ZlibConnection*>(con->private_ptr);
+  R_ReleaseObject(z->inner_sexp);
+  delete z;
+  con->private_ptr = nullptr;
+}
+
+}  // namespace
+
+//' Create a zlib Connection
+//'
+//' Wrap an R connection in a connection that decompresses what is read from it or
+//' compresses what is written to it, in any format \code{wbits} can describe. This is the
+//' engine behind \code{zlib_connection()}, which chooses the default \code{wbits} for the mode.
+//' @param con A connection. It is opened in binary mode if it is not open yet and is closed
+//' together with the returned connection.
+//' @param mode \code{"r"} or \code{"rb"} to read, \code{"w"} or \code{"wb"} to write. Without
+//' \code{"b"} the connection is in text mode.
+//' @param wbits Window size bits. 8..15 for zlib, 24..31 for gzip, -15..-8 for raw deflate and
+//' 40..47 (reading only) for automatic zlib or gzip detection.
+//' @param level Compression level when writing, integer between 0 and 9, or -1 for default.
+//' @param buffer_size Size of the internal buffers in bytes.
+//' @return An open connection.
+//' @examples
+//' gz_file <- tempfile(fileext = ".gz")
+//' con <- create_zlib_connection(file(gz_file), "wb", wbits = 31)
+//' writeBin(charToRaw("Hello, World"), con)
+//' close(con)
+//' rawToChar(memDecompress(readBin(gz_file, "raw", 100), type = "gzip"))
+//' @export
+// [[Rcpp::export]]
+SEXP create_zlib_connection(SEXP con, std::string mode = "rb", int wbits = 47, int level = -1,
+                            int buffer_size = 262144) {
+  bool reading = mode == "r" || mode == "rb" || mode == "rt";
+  bool writing = mode == "w" || mode == "wb" || mode == "wt";
+  if (!reading && !writing) {
+    stop("mode must be \"r\", \"rb\", \"w\" or \"wb\"");
+  }
+  if (buffer_size < 1) {
+    stop("buffer_size must be positive");
+  }
+
+  Rconnection inner = R_GetConnection(con);
+  if (!inner->isopen) {
+    std::strcpy(inner->mode, reading ? "rb" : "wb");
+    if (!inner->open(inner)) {
+      stop("Cannot open the underlying connection");
+    }
+  }
+  if (reading ? !inner->canread : !inner->canwrite) {
+    stop(reading ? "The underlying connection cannot be read" : "The underlying connection cannot be written");
+  }
+
+  std::unique_ptr<ZlibConnection> z(new ZlibConnection());
+  z->buffer_size = static_cast<size_t>(buffer_size);
+  z->input.resize(z->buffer_size);
+  if (reading) {
+    z->decompressor = acquire_decompressor(wbits);
+    decompress_totals.streams.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    z->compressor = acquire_compressor(level, Z_DEFLATED, wbits, 8, Z_DEFAULT_STRATEGY);
+    compress_totals.streams.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  std::string description = std::string("zlib(") + inner->description + ")";
+  Rconnection zcon;
+  SEXP result = PROTECT(R_new_custom_connection(description.c_str(), mode.c_str(), "zlib_connection", &zcon));
+  zcon->isopen = TRUE;
+  zcon->text = mode.find('b') == std::string::npos ? TRUE : FALSE;
+  zcon->canread = reading ? TRUE : FALSE;
+  zcon->canwrite = writing ? TRUE : FALSE;
+  zcon->canseek = FALSE;
+  zcon->blocking = TRUE;
+  zcon->close = &zlib_close;
+  zcon->destroy = &zlib_destroy;
+  zcon->read = &zlib_read;
+  zcon->fgetc_internal = &zlib_fgetc;
+  zcon->write = &zlib_write;
+
+  z->inner = inner;
+  z->inner_sexp = con;
+  R_PreserveObject(con);  // Keeps the inner connection from being finalized meanwhile
+  zcon->private_ptr = z.release();
+
+  UNPROTECT(1);
+  return result;
+}
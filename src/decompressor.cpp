@@ -1,92 +1,230 @@
 #include <Rcpp.h>
 #include <zlib.h>
+#include <algorithm>
+#include <climits>
+#include "decompressor.h"
+#include "dictionary.h"
+#include "gzip.h"
+#include "pool.h"
 
 using namespace Rcpp;
 
-struct Decompressor {
-  z_stream strm{};
-  std::vector<uint8_t> buffer;
-};
+namespace {
+
+// Switch a decompressor in detect mode to the format of the stream starting at `in`, which
+// holds at least two bytes. gzip and zlib headers are recognized by their magic bytes and
+// header check; anything else is taken to be raw deflate. A raw stream can only start with a
+// valid zlib header if a stored block is padded with set bits, which zlib never writes.
+void start_member(Decompressor& decompressor, const uint8_t* in, size_t consumed, size_t produced) {
+  StreamMember member;
+  int wbits;
+  if (in[0] == 0x1f && in[1] == 0x8b) {
+    member.format = "gzip";
+    wbits = MAX_WBITS + 16;
+  } else if ((in[0] & 0x0f) == Z_DEFLATED && (in[0] >> 4) + 8 <= MAX_WBITS && (in[0] << 8 | in[1]) % 31 == 0) {
+    member.format = "zlib";
+    wbits = MAX_WBITS;
+  } else {
+    member.format = "deflate";
+    wbits = -MAX_WBITS;
+  }
+  inflateReset2(&decompressor.strm, wbits);
+  if (wbits < 0 && !decompressor.zdict.empty()) {
+    inflateSetDictionary(&decompressor.strm, decompressor.zdict.data(),
+                         static_cast<uInt>(decompressor.zdict.size()));
+  }
+  member.in_offset = decompressor.total_in + consumed;
+  member.out_offset = decompressor.total_out + produced;
+  decompressor.members.push_back(member);
+  decompressor.at_member_start = false;
+}
+
+}  // namespace
+
+void reset_decompressor(Decompressor& decompressor) {
+  inflateReset(&decompressor.strm);
+  decompressor.at_member_start = decompressor.detect;
+  if (decompressor.wbits < 0 && !decompressor.zdict.empty()) {
+    // Raw deflate carries no dictionary ID, so the dictionary is set up front
+    inflateSetDictionary(&decompressor.strm, decompressor.zdict.data(),
+                         static_cast<uInt>(decompressor.zdict.size()));
+  }
+}
+
+size_t inflate_into(Decompressor& decompressor, const uint8_t* in, size_t in_len,
+                    std::vector<uint8_t>& out, size_t& produced, size_t limit) {
+  z_stream& strm = decompressor.strm;
+  StreamStats& stats = decompressor.stats;
+  size_t consumed = 0;
+  size_t start = produced;
+
+  while (true) {
+    if (decompressor.at_member_start) {
+      if (in_len - consumed < 2) {
+        break;  // The format is only known from two bytes on, the rest stays pending
+      }
+      start_member(decompressor, in + consumed, consumed, produced - start);
+    }
+    if (produced == out.size()) {
+      if (produced >= limit) {
+        break;  // Bounded output reached, the rest of the input stays pending
+      }
+      // Grow the output geometrically, but never past the limit
+      size_t grown = std::max(out.size() * 2, std::max<size_t>(in_len * 2, 16384));
+      out.resize(std::min(grown, limit));
+      stats.buffer_resizes++;
+    }
+
+    // avail_in / avail_out are 32-bit, so long vectors are fed in windows
+    strm.next_in = const_cast<Bytef*>(in + consumed);
+    strm.avail_in = static_cast<uInt>(std::min<size_t>(in_len - consumed, UINT_MAX));
+    strm.next_out = out.data() + produced;
+    strm.avail_out = static_cast<uInt>(std::min<size_t>(out.size() - produced, UINT_MAX));
+    uInt avail_in = strm.avail_in;
+    uInt avail_out = strm.avail_out;
+
+    int ret = inflate(&strm, Z_SYNC_FLUSH);
+    consumed += avail_in - strm.avail_in;
+    produced += avail_out - strm.avail_out;
+    stats.calls++;
+    stats.flushes[Z_SYNC_FLUSH]++;
+
+    if (ret == Z_NEED_DICT) {
+      ret = set_needed_dictionary(strm, decompressor.zdict.data(), decompressor.zdict.size());
+      if (ret == Z_NEED_DICT) {
+        Rcpp::Rcerr << "zlib error: no dictionary registered for dictionary ID " << strm.adler << std::endl;
+        stop("Decompression failed");
+      }
+    }
+    if (ret == Z_STREAM_END) {
+      if (decompressor.detect) {
+        // zlib has checked the trailer of gzip and zlib streams before returning Z_STREAM_END
+        StreamMember& member = decompressor.members.back();
+        member.in_size = decompressor.total_in + consumed - member.in_offset;
+        member.out_size = decompressor.total_out + (produced - start) - member.out_offset;
+        member.complete = true;
+      }
+      reset_decompressor(decompressor);
+      stats.stream_ends++;
+      if (consumed == in_len) {
+        break;
+      }
+      continue;  // Another stream follows in the same input
+    }
+    if (ret == Z_BUF_ERROR) {
+      break;  // No progress possible without more input
+    }
+    if (ret != Z_OK) {
+      Rcpp::Rcerr << "zlib error: " << (strm.msg ? strm.msg : "Unknown error") << std::endl;
+      stop("Decompression failed");
+    }
+    if (consumed == in_len && strm.avail_out > 0) {
+      break;  // All input used and no output pending inside zlib
+    }
+  }
+
+  stats.bytes_in += consumed;
+  stats.bytes_out += produced - start;
+  decompressor.total_in += consumed;
+  decompressor.total_out += produced - start;
+  if (decompressor.detect && !decompressor.members.empty() && !decompressor.members.back().complete) {
+    StreamMember& member = decompressor.members.back();
+    member.in_size = decompressor.total_in - member.in_offset;
+    member.out_size = decompressor.total_out - member.out_offset;
+  }
+  return consumed;
+}
 
 //' Create a new decompressor object
 //'
 //' Initialize a new decompressor object for zlib-based decompression.
 //' @param wbits The window size bits parameter. Default is 0.
+//' @param zdict Optional predefined dictionary as a raw vector. zlib streams requesting a
+//' different dictionary are answered from \code{register_dictionary()}.
+//' @param detect If \code{TRUE}, \code{wbits} is not used and the format of every stream is
+//' detected from its first two bytes instead: gzip, zlib or, failing both, raw deflate.
+//' Streams of any of these formats can follow each other in the input and are inflated in a
+//' single pass; their boundaries are listed by \code{decompressor_members()}.
 //' @return A SEXP pointer to the new decompressor object.
 //' @examples
 //' decompressor <- create_decompressor()
+//' mixed <- c(compress(charToRaw("gzip "), wbits = 31), compress(charToRaw("zlib "), wbits = 15),
+//'            compress(charToRaw("deflate"), wbits = -15))
+//' rawToChar(decompress_chunk(create_decompressor(detect = TRUE), mixed))
 //' @export
 // [[Rcpp::export]]
-SEXP create_decompressor(int wbits = 0) {
-  Decompressor* decompressor = nullptr;  // Initialize to nullptr
-
-  try {
-    decompressor = new Decompressor();
-
-    decompressor->strm.zalloc = Z_NULL;
-    decompressor->strm.zfree = Z_NULL;
-    decompressor->strm.opaque = Z_NULL;
-    decompressor->strm.avail_in = 0;
-    decompressor->strm.next_in = Z_NULL;
+SEXP create_decompressor(int wbits = 0, Nullable<RawVector> zdict = R_NilValue, bool detect = false) {
+  if (detect) {
+    wbits = MAX_WBITS + 32;  // Switched to the detected format with inflateReset2() per stream
+  }
+  // Streams come from the pool and go back to it when the object is garbage collected
+  PooledDecompressor decompressor = acquire_decompressor(wbits);
+  decompress_totals.streams.fetch_add(1, std::memory_order_relaxed);
+  decompressor->detect = detect;
+  decompressor->at_member_start = detect;
 
-    if (inflateInit2(&decompressor->strm, wbits) != Z_OK) {
-      throw std::runtime_error("Failed to initialize decompressor");
+  // Set the decompression dictionary if provided
+  if (zdict.isNotNull()) {
+    RawVector dictVec(zdict);
+    decompressor->zdict.assign(dictVec.begin(), dictVec.end());
+    if (wbits < 0 && inflateSetDictionary(&decompressor->strm, dictVec.begin(), dictVec.size()) != Z_OK) {
+      throw std::runtime_error("Failed to set dictionary");
     }
-
-  } catch (...) {
-    delete decompressor;  // Safely delete if an exception is thrown
-    throw;  // Re-throw the caught exception
   }
 
-  return XPtr<Decompressor>(decompressor, true);  // Now it's safe to return
+  return XPtr<Decompressor, PreserveStorage, release_decompressor>(decompressor.release(), true);
 }
 
 
 //' Decompress a chunk of data
 //'
 //' Perform chunk-wise decompression on a given raw vector using a decompressor object.
+//' The input is inflated in place without being copied, until it is fully consumed.
+//' When \code{max_output} is given, at most that many bytes are returned and the unconsumed
+//' input is kept pending; call again (with new or empty input) to pull the next piece.
 //' @param decompressorPtr An external pointer to an initialized decompressor object.
 //' @param input_chunk A raw vector containing the compressed data chunk.
+//' @param max_output Maximum number of bytes to return, or -1 (default) for no limit.
 //' @return A raw vector containing the decompressed data.
 //' @examples
 //' rawToChar(decompress_chunk(create_decompressor(), memCompress(charToRaw("Hello, World"))))
 //' @export
 // [[Rcpp::export]]
-RawVector decompress_chunk(SEXP decompressorPtr, const RawVector& input_chunk) {
+RawVector decompress_chunk(SEXP decompressorPtr, const RawVector& input_chunk, double max_output = -1) {
   XPtr<Decompressor> decompressor(decompressorPtr);
   if (!decompressor) {
     stop("Invalid decompressor object");
   }
 
-  decompressor->buffer.insert(decompressor->buffer.end(), input_chunk.begin(), input_chunk.end());
-  decompressor->strm.avail_in = decompressor->buffer.size();
-  decompressor->strm.next_in = decompressor->buffer.data();
-
-  size_t available_out = 2 * decompressor->buffer.size();
-  std::vector<uint8_t> out(available_out);
-  decompressor->strm.avail_out = available_out;
-  decompressor->strm.next_out = out.data();
-
-  int ret = inflate(&decompressor->strm, Z_SYNC_FLUSH);
-  if (ret == Z_STREAM_END) {
-    inflateReset(&decompressor->strm);
-  } else if (ret != Z_OK) {
-    Rcpp::Rcerr << "zlib error: " << (decompressor->strm.msg ? decompressor->strm.msg : "Unknown error") << std::endl;
-    stop("Decompression failed");
-  }
+  StatsScope scope(decompressor->stats, decompress_totals);
+  size_t limit = max_output < 0 ? SIZE_MAX : static_cast<size_t>(max_output);
+  std::vector<uint8_t>& pending = decompressor->buffer;
+  std::vector<uint8_t> out;
+  size_t produced = 0;
 
-  auto diff = static_cast<std::vector<uint8_t>::difference_type>(decompressor->buffer.size() - decompressor->strm.avail_in);
-  decompressor->buffer.erase(decompressor->buffer.begin(), decompressor->buffer.begin() + diff);
+  if (pending.empty()) {
+    // Inflate straight from the caller's vector and keep only what is left over
+    const uint8_t* in = input_chunk.begin();
+    size_t in_len = static_cast<size_t>(input_chunk.size());
+    size_t consumed = inflate_into(*decompressor, in, in_len, out, produced, limit);
+    pending.assign(in + consumed, in + in_len);
+    decompressor->stats.memmove_bytes += in_len - consumed;
+  } else {
+    pending.insert(pending.end(), input_chunk.begin(), input_chunk.end());
+    size_t consumed = inflate_into(*decompressor, pending.data(), pending.size(), out, produced, limit);
+    pending.erase(pending.begin(), pending.begin() + static_cast<std::ptrdiff_t>(consumed));
+    decompressor->stats.memmove_bytes += input_chunk.size() + pending.size();
+  }
 
-  auto actual_out_diff = static_cast<std::vector<uint8_t>::difference_type>(available_out - decompressor->strm.avail_out);
-  return {out.begin(), out.begin() + actual_out_diff};
+  return RawVector(out.begin(), out.begin() + static_cast<std::ptrdiff_t>(produced));
 }
 
 //' Flush the internal buffer of the decompressor object.
 //'
 //' This function processes all pending input and returns the remaining uncompressed output.
 //' The function uses the provided initial buffer size and dynamically expands it as necessary
-//' to ensure all remaining data is decompressed. After calling this function, the
+//' to ensure all remaining data is decompressed. When the pending input is a whole gzip
+//' member, the buffer is sized from its trailer instead. After calling this function, the
 //' decompress_chunk() method cannot be called again on the same object.
 //' @param decompressorPtr A SEXP pointer to an existing decompressor object.
 //' @param length An optional parameter that sets the initial size of the output buffer. Default is 256.
@@ -107,38 +245,112 @@ RawVector flush_decompressor_buffer(SEXP decompressorPtr, size_t length = 256) {
         return RawVector::create();
     }
 
-    decompressor->strm.avail_in = decompressor->buffer.size();
-    decompressor->strm.next_in = decompressor->buffer.data();
-
-    std::vector<uint8_t> output(length);
+    StatsScope scope(decompressor->stats, decompress_totals);
+    size_t isize = decompressor->wbits > 15 ? gzip_isize(decompressor->buffer.data(), decompressor->buffer.size()) : 0;
+    std::vector<uint8_t> output(std::max<size_t>(std::max(length, isize), 1));
+    decompressor->stats.buffer_resizes++;
     size_t total_decompressed = 0;
 
-    int ret;
-   do {
-       if (total_decompressed == output.size()) {
-           output.resize(output.size() * 2);  // Double the buffer size
-       }
-
-       decompressor->strm.avail_out = output.size() - total_decompressed;
-       decompressor->strm.next_out = &output[total_decompressed];
-
-       ret = inflate(&decompressor->strm, Z_NO_FLUSH);
-
-       if (ret < 0 && ret != Z_BUF_ERROR) {
-           Rcpp::Rcerr << "zlib error code: " << ret << " - "
-                       << (decompressor->strm.msg ? decompressor->strm.msg : "Unknown error") << std::endl;
-           stop("Flush failed");
-       }
+    inflate_into(*decompressor, decompressor->buffer.data(), decompressor->buffer.size(),
+                 output, total_decompressed, SIZE_MAX);
+    decompressor->buffer.clear();       // Clear the internal buffer
 
-       total_decompressed = output.size() - decompressor->strm.avail_out;
+    return RawVector(output.begin(), output.begin() + static_cast<std::ptrdiff_t>(total_decompressed));
+}
 
-   } while (decompressor->strm.avail_in > 0 || ret == Z_BUF_ERROR);
+//' Clone a Decompressor Object
+//'
+//' Copy the complete state of a decompressor with \code{inflateCopy}, including its window
+//' and the input it holds pending. The clone continues from the same point of the stream, so
+//' alternative continuations can be tried, or a failed range fetch retried, without inflating
+//' the stream again from the start.
+//' @param decompressorPtr An external pointer to an existing decompressor object.
+//' @return A SEXP pointer to the new decompressor object.
+//' @examples
+//' compressed_data <- memCompress(charToRaw(strrep("Hello, World. ", 100)))
+//' decompressor <- create_decompressor()
+//' head <- decompress_chunk(decompressor, compressed_data[1:10])
+//' fork <- clone_decompressor(decompressor)
+//' rest <- decompress_chunk(fork, compressed_data[-(1:10)])
+//' identical(c(head, rest), charToRaw(strrep("Hello, World. ", 100)))
+//' @export
+// [[Rcpp::export]]
+SEXP clone_decompressor(SEXP decompressorPtr) {
+  XPtr<Decompressor> source(decompressorPtr);
+  if (!source) {
+    stop("Invalid decompressor object");
+  }
 
-    output.resize(total_decompressed);  // Trim the output to the actual decompressed size
-    decompressor->buffer.clear();       // Clear the internal buffer
+  PooledDecompressor clone(new Decompressor());
+  if (inflateCopy(&clone->strm, &source->strm) != Z_OK) {
+    stop("Failed to clone decompressor");
+  }
+  decompress_totals.streams.fetch_add(1, std::memory_order_relaxed);
+  clone->buffer = source->buffer;  // Input not consumed yet
+  clone->zdict = source->zdict;
+  clone->wbits = source->wbits;
+  clone->pooled = source->pooled;
+  clone->detect = source->detect;
+  clone->at_member_start = source->at_member_start;
+  clone->total_in = source->total_in;
+  clone->total_out = source->total_out;
+  clone->members = source->members;
 
-    return RawVector(output.begin(), output.end());
+  return XPtr<Decompressor, PreserveStorage, release_decompressor>(clone.release(), true);
 }
 
+//' Streams Seen by a Decompressor
+//'
+//' List the streams a decompressor in detect mode has come across so far, with their format
+//' and where they are in the concatenated input and output. Rows are added as soon as a
+//' stream starts, so a caller can split the output by stream while the input is still
+//' arriving. The check value in the trailer of a complete gzip or zlib stream has been
+//' verified.
+//' @param decompressorPtr An external pointer to a decompressor created with
+//' \code{detect = TRUE}.
+//' @param drain If \code{TRUE}, the complete streams are removed from the list once returned,
+//' which keeps the list short on long-running feeds.
+//' @return A data frame with one row per stream and the columns \code{format} (\code{"gzip"},
+//' \code{"zlib"} or \code{"deflate"}), \code{in_offset} and \code{in_size} (bytes of
+//' compressed input, offsets from the first byte passed to the decompressor),
+//' \code{out_offset} and \code{out_size} (bytes of output) and \code{complete}.
+//' @examples
+//' decompressor <- create_decompressor(detect = TRUE)
+//' mixed <- c(compress(charToRaw("first"), wbits = 31), compress(charToRaw("second")))
+//' output <- decompress_chunk(decompressor, mixed)
+//' decompressor_members(decompressor)
+//' @export
+// [[Rcpp::export]]
+DataFrame decompressor_members(SEXP decompressorPtr, bool drain = false) {
+  XPtr<Decompressor> decompressor(decompressorPtr);
+  if (!decompressor) {
+    stop("Invalid decompressor object");
+  }
+  if (!decompressor->detect) {
+    stop("The decompressor is not in detect mode");
+  }
 
+  std::vector<StreamMember>& members = decompressor->members;
+  size_t n = members.size();
+  CharacterVector format(n);
+  NumericVector in_offset(n), in_size(n), out_offset(n), out_size(n);
+  LogicalVector complete(n);
+  for (size_t i = 0; i < n; i++) {
+    const StreamMember& m = members[i];
+    format[i] = m.format;
+    in_offset[i] = static_cast<double>(m.in_offset);
+    in_size[i] = static_cast<double>(m.in_size);
+    out_offset[i] = static_cast<double>(m.out_offset);
+    out_size[i] = static_cast<double>(m.out_size);
+    complete[i] = m.complete;
+  }
+  if (drain) {
+    // Only the last stream can still be open
+    bool open = n > 0 && !members.back().complete;
+    members.erase(members.begin(), members.end() - (open ? 1 : 0));
+  }
 
+  return DataFrame::create(Named("format") = format, Named("in_offset") = in_offset, Named("in_size") = in_size,
+                           Named("out_offset") = out_offset, Named("out_size") = out_size,
+                           Named("complete") = complete, Named("stringsAsFactors") = false);
+}
@@ -0,0 +1,51 @@
+#ifndef ZLIB_DECOMPRESSOR_H
+#define ZLIB_DECOMPRESSOR_H
+
+#include <zlib.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "stats.h"
+
+// One stream of a decompressor in detect mode, located in the concatenated input and output
+struct StreamMember {
+  const char* format;  // "gzip", "zlib" or "deflate"
+  uint64_t in_offset = 0;
+  uint64_t in_size = 0;
+  uint64_t out_offset = 0;
+  uint64_t out_size = 0;
+  bool complete = false;
+};
+
+struct Decompressor {
+  z_stream strm{};
+  std::vector<uint8_t> buffer;  // Unconsumed input tail, only kept when output was bounded
+  std::vector<uint8_t> zdict;   // Preset dictionary, also answered for raw deflate streams
+  int wbits = 0;
+  StreamStats stats;
+  bool pooled = false;  // Allocated on the arena and returned to the stream pool, see pool.cpp
+
+  // Detect mode: the format of every stream is sniffed from its first bytes
+  bool detect = false;
+  bool at_member_start = false;
+  uint64_t total_in = 0;   // Input consumed and output produced over all streams
+  uint64_t total_out = 0;
+  std::vector<StreamMember> members;
+
+  ~Decompressor() {
+    inflateEnd(&strm);
+  }
+};
+
+// Reset the stream for the next concatenated stream, restoring a raw deflate dictionary.
+// In detect mode the next stream's format is sniffed again.
+void reset_decompressor(Decompressor& decompressor);
+
+// Inflate `in_len` bytes from `in`, appending to `out` from offset `produced` and growing it
+// geometrically, until the input is used up or `limit` output bytes exist.
+// Concatenated streams are inflated back to back and dictionary requests are answered from
+// the decompressor's zdict or the dictionary registry. Returns the number of input bytes consumed.
+size_t inflate_into(Decompressor& decompressor, const uint8_t* in, size_t in_len,
+                    std::vector<uint8_t>& out, size_t& produced, size_t limit);
+
+#endif // ZLIB_DECOMPRESSOR_H
@@ -0,0 +1,200 @@
+#include <Rcpp.h>
+#include <zlib.h>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include "dictionary.h"
+
+using namespace Rcpp;
+
+namespace {
+
+const size_t KMER = 8;         // Length of the substrings counted across samples
+const size_t SEGMENT = 64;     // Length of the candidate segments copied into the dictionary
+const size_t STEP = 16;        // Distance between candidate segment starts
+const size_t MAX_DICT = 32768; // Deflate can only reference the last 32 KiB
+
+struct Candidate {
+  uint64_t score;
+  size_t sample;
+  size_t pos;
+  size_t len;
+  bool operator<(const Candidate& other) const { return score < other.score; }
+};
+
+inline uint64_t kmer_at(const uint8_t* p) {
+  uint64_t key;
+  std::memcpy(&key, p, KMER);
+  return key;
+}
+
+// Registered decompression dictionaries, keyed by their Adler-32 dictionary ID
+std::mutex registry_mutex;
+std::map<uLong, std::vector<uint8_t>> registry;
+
+}  // namespace
+
+int set_needed_dictionary(z_stream& strm, const uint8_t* dict, size_t dict_size) {
+  if (dict && adler32(1L, dict, static_cast<uInt>(dict_size)) == strm.adler) {
+    return inflateSetDictionary(&strm, dict, static_cast<uInt>(dict_size));
+  }
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  auto it = registry.find(strm.adler);
+  if (it == registry.end()) {
+    return Z_NEED_DICT;
+  }
+  return inflateSetDictionary(&strm, it->second.data(), static_cast<uInt>(it->second.size()));
+}
+
+//' Train a Compression Dictionary
+//'
+//' Build a preset dictionary for \code{zdict} from a corpus of sample messages. Substrings of
+//' 8 bytes are counted by the number of samples they occur in, and 64 byte segments of the
+//' samples are then picked greedily by the total frequency of the substrings they still add.
+//' Deflate encodes closer matches with fewer bits, so the most valuable segments are placed
+//' at the end of the dictionary.
+//' @param samples A list of raw vectors with representative messages.
+//' @param size Maximum size of the dictionary in bytes, at most 32768.
+//' @return A raw vector containing the dictionary.
+//' @examples
+//' records <- lapply(1:1000, function(i) charToRaw(paste0('{"id":', i, ',"name":"row"}')))
+//' dictionary <- train_dictionary(records, size = 1024)
+//' compressed <- compress(records[[1]], zdict = dictionary)
+//' identical(decompress(compressed, zdict = dictionary), records[[1]])
+//' @export
+// [[Rcpp::export]]
+RawVector train_dictionary(const List& samples, int size = 32768) {
+  if (size < 1 || static_cast<size_t>(size) > MAX_DICT) {
+    stop("size must be between 1 and 32768");
+  }
+
+  std::vector<RawVector> data;
+  for (R_xlen_t i = 0; i < samples.size(); i++) {
+    SEXP element = VECTOR_ELT(samples, i);
+    if (TYPEOF(element) != RAWSXP) {
+      stop("Sample " + std::to_string(i + 1) + " is not a raw vector");
+    }
+    data.push_back(RawVector(element));
+  }
+
+  // Document frequency of every substring: in how many samples it occurs
+  std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> frequency;  // count, last sample + 1
+  for (size_t s = 0; s < data.size(); s++) {
+    const uint8_t* bytes = data[s].begin();
+    size_t len = static_cast<size_t>(data[s].size());
+    for (size_t p = 0; p + KMER <= len; p++) {
+      auto& entry = frequency[kmer_at(bytes + p)];
+      if (entry.second != s + 1) {
+        entry.first++;
+        entry.second = static_cast<uint32_t>(s + 1);
+      }
+    }
+    if (s % 1024 == 0) checkUserInterrupt();
+  }
+
+  // Substrings seen in a single sample cannot pay for their space in the dictionary
+  auto score = [&](const Candidate& c) {
+    const uint8_t* bytes = data[c.sample].begin() + c.pos;
+    uint64_t total = 0;
+    for (size_t p = 0; p + KMER <= c.len; p++) {
+      auto it = frequency.find(kmer_at(bytes + p));
+      if (it != frequency.end() && it->second.first > 1) total += it->second.first;
+    }
+    return total;
+  };
+
+  std::priority_queue<Candidate> candidates;
+  for (size_t s = 0; s < data.size(); s++) {
+    size_t len = static_cast<size_t>(data[s].size());
+    if (len < KMER) continue;
+    for (size_t p = 0; ; p += STEP) {
+      Candidate c{0, s, std::min(p, len - std::min(len, SEGMENT)), std::min(len, SEGMENT)};
+      c.score = score(c);
+      if (c.score > 0) candidates.push(c);
+      if (c.pos + c.len >= len) break;
+    }
+  }
+
+  // Lazy greedy selection: a candidate is re-scored against the substrings already covered
+  // and only taken if it still beats the next best candidate.
+  std::vector<Candidate> picked;
+  size_t total = 0;
+  while (!candidates.empty() && total < static_cast<size_t>(size)) {
+    Candidate c = candidates.top();
+    candidates.pop();
+    uint64_t current = score(c);
+    if (current == 0) continue;
+    if (current < c.score && !candidates.empty() && current < candidates.top().score) {
+      c.score = current;
+      candidates.push(c);
+      continue;
+    }
+
+    const uint8_t* bytes = data[c.sample].begin() + c.pos;
+    for (size_t p = 0; p + KMER <= c.len; p++) {
+      auto it = frequency.find(kmer_at(bytes + p));
+      if (it != frequency.end()) it->second.first = 0;
+    }
+    picked.push_back(c);
+    total += c.len;
+  }
+
+  if (picked.empty()) {
+    stop("No content repeats across the samples");
+  }
+
+  // Most valuable segment last, closest to the data being compressed
+  std::vector<uint8_t> dictionary;
+  dictionary.reserve(total);
+  for (auto it = picked.rbegin(); it != picked.rend(); ++it) {
+    const uint8_t* bytes = data[it->sample].begin() + it->pos;
+    dictionary.insert(dictionary.end(), bytes, bytes + it->len);
+  }
+  size_t skip = dictionary.size() > static_cast<size_t>(size) ? dictionary.size() - size : 0;
+
+  return RawVector(dictionary.begin() + static_cast<std::ptrdiff_t>(skip), dictionary.end());
+}
+
+//' Register a Decompression Dictionary
+//'
+//' Make a preset dictionary known to every decompressor of the session. When a zlib stream
+//' asks for a dictionary (\code{Z_NEED_DICT}), the decompressor looks it up by the stream's
+//' dictionary ID, the Adler-32 checksum of the dictionary, so data compressed with any
+//' registered \code{zdict} can be decompressed without passing the dictionary along.
+//' @param zdict A raw vector containing the dictionary.
+//' @return The dictionary ID as a number.
+//' @examples
+//' dictionary <- charToRaw("Hello, World")
+//' id <- register_dictionary(dictionary)
+//' decompress(compress(charToRaw("Hello"), zdict = dictionary))
+//' unregister_dictionary(id)
+//' @export
+// [[Rcpp::export]]
+double register_dictionary(const RawVector& zdict) {
+  if (zdict.size() == 0 || static_cast<size_t>(zdict.size()) > UINT_MAX) {
+    stop("Invalid dictionary size");
+  }
+  uLong id = adler32(1L, zdict.begin(), static_cast<uInt>(zdict.size()));
+
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  registry[id].assign(zdict.begin(), zdict.end());
+  return static_cast<double>(id);
+}
+
+//' Unregister a Decompression Dictionary
+//'
+//' Remove a dictionary added with \code{register_dictionary()}.
+//' @param id The dictionary ID returned by \code{register_dictionary()}.
+//' @return \code{TRUE} if a dictionary was removed, \code{FALSE} otherwise.
+//' @examples
+//' id <- register_dictionary(charToRaw("Hello, World"))
+//' unregister_dictionary(id)
+//' @export
+// [[Rcpp::export]]
+bool unregister_dictionary(double id) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  return registry.erase(static_cast<uLong>(id)) > 0;
+}
@@ -0,0 +1,14 @@
+#ifndef ZLIB_DICTIONARY_H
+#define ZLIB_DICTIONARY_H
+
+#include <zlib.h>
+#include <cstddef>
+#include <cstdint>
+
+// Answer a Z_NEED_DICT from inflate(). The stream's requested dictionary ID (strm.adler) is
+// matched against `dict` first and then against the registered dictionaries. Returns the
+// result of inflateSetDictionary, or Z_NEED_DICT when no dictionary with that ID is known.
+// Safe to call from worker threads.
+int set_needed_dictionary(z_stream& strm, const uint8_t* dict, size_t dict_size);
+
+#endif // ZLIB_DICTIONARY_H
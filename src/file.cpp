@@ -0,0 +1,208 @@
+#include <Rcpp.h>
+#include <zlib.h>
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include "input_file.h"
+
+using namespace Rcpp;
+
+namespace {
+
+// Buffered output writer issuing large, buffer sized writes.
+class OutputFile {
+public:
+  OutputFile(const std::string& path, size_t buffer_size) : path_(path), buffer_(buffer_size) {
+    file_ = fopen(path.c_str(), "wb");
+    if (!file_) {
+      stop("Failed to open file: " + path);
+    }
+    setvbuf(file_, nullptr, _IONBF, 0);  // Our own buffer is already large
+  }
+
+  ~OutputFile() {
+    if (file_) fclose(file_);
+  }
+
+  uint8_t* data() { return buffer_.data(); }
+  size_t size() const { return buffer_.size(); }
+
+  void write(size_t len) {
+    if (len > 0 && fwrite(buffer_.data(), 1, len, file_) != len) {
+      stop("Failed to write file: " + path_);
+    }
+    written_ += len;
+  }
+
+  void close() {
+    if (fclose(file_) != 0) {
+      file_ = nullptr;
+      stop("Failed to write file: " + path_);
+    }
+    file_ = nullptr;
+  }
+
+  double written() const { return static_cast<double>(written_); }
+
+private:
+  std::string path_;
+  FILE* file_ = nullptr;
+  std::vector<uint8_t> buffer_;
+  uint64_t written_ = 0;
+};
+
+struct StreamGuard {
+  z_stream* strm;
+  bool deflating;
+  ~StreamGuard() { deflating ? deflateEnd(strm) : inflateEnd(strm); }
+};
+
+size_t checked_buffer_size(double buffer_size) {
+  if (buffer_size < 1024 || buffer_size > 1073741824.0) {
+    stop("buffer_size must be between 1 KiB and 1 GiB");
+  }
+  return static_cast<size_t>(buffer_size);
+}
+
+}  // namespace
+
+//' Compress a File to Gzip
+//'
+//' Compress \code{input_path} into \code{output_path} natively, without loading the file
+//' into R. The input is memory mapped (where supported) and streamed through a single
+//' \code{z_stream} with large buffers, so memory use stays constant regardless of file size.
+//' @param input_path A string representing the path of the file to compress.
+//' @param output_path A string representing the path of the compressed file to write.
+//' @param level Compression level, integer between 0 and 9, or -1 for default.
+//' @param wbits Window size bits. Default is 31 (gzip), use 15 for zlib or -15 for raw deflate.
+//' @param memLevel Memory level for internal compression state.
+//' @param strategy Compression strategy.
+//' @param buffer_size Size of the output buffer and of each write in bytes. Default is 1 MiB.
+//' @return The number of compressed bytes written.
+//' @examples
+//' input_file <- tempfile()
+//' writeLines(rep("Hello, World", 1000), input_file)
+//' gzip_file(input_file, paste0(input_file, ".gz"))
+//' @export
+// [[Rcpp::export]]
+double gzip_file(const std::string& input_path, const std::string& output_path, int level = -1,
+                 int wbits = 31, int memLevel = 8, int strategy = 0, double buffer_size = 1048576) {
+  size_t bufsize = checked_buffer_size(buffer_size);
+  InputFile input(input_path, bufsize);
+  OutputFile output(output_path, bufsize);
+
+  z_stream strm{};
+  strm.zalloc = Z_NULL;
+  strm.zfree = Z_NULL;
+  strm.opaque = Z_NULL;
+  if (deflateInit2(&strm, level, Z_DEFLATED, wbits, memLevel, strategy) != Z_OK) {
+    stop("Failed to initialize compressor");
+  }
+  StreamGuard guard{&strm, true};
+
+  const uint8_t* data = nullptr;
+  size_t len = 0;
+  bool more = input.next(data, len, UINT_MAX);
+  int ret;
+
+  do {
+    strm.next_in = const_cast<Bytef*>(data);
+    strm.avail_in = static_cast<uInt>(more ? len : 0);
+    int flush = Z_NO_FLUSH;
+    if (!more) {
+      flush = Z_FINISH;
+    }
+
+    do {
+      strm.next_out = output.data();
+      strm.avail_out = static_cast<uInt>(output.size());
+      ret = deflate(&strm, flush);
+      if (ret == Z_STREAM_ERROR) {
+        stop("Compression failed");
+      }
+      output.write(output.size() - strm.avail_out);
+    } while (strm.avail_out == 0);
+
+    checkUserInterrupt();
+    if (more) {
+      more = input.next(data, len, UINT_MAX);
+    }
+  } while (ret != Z_STREAM_END);
+
+  output.close();
+  return output.written();
+}
+
+//' Decompress a Gzip File
+//'
+//' Decompress \code{input_path} into \code{output_path} natively, without loading the file
+//' into R. The input is memory mapped (where supported) and streamed through a single
+//' \code{z_stream} with large buffers. Concatenated gzip members are all decompressed.
+//' @param input_path A string representing the path of the compressed file.
+//' @param output_path A string representing the path of the decompressed file to write.
+//' @param wbits Window size bits. Default is 47 (automatic zlib or gzip detection).
+//' @param buffer_size Size of the output buffer and of each write in bytes. Default is 1 MiB.
+//' @return The number of decompressed bytes written.
+//' @examples
+//' input_file <- tempfile()
+//' writeLines(rep("Hello, World", 1000), input_file)
+//' gzip_file(input_file, paste0(input_file, ".gz"))
+//' gunzip_file(paste0(input_file, ".gz"), paste0(input_file, ".out"))
+//' @export
+// [[Rcpp::export]]
+double gunzip_file(const std::string& input_path, const std::string& output_path, int wbits = 47,
+                   double buffer_size = 1048576) {
+  size_t bufsize = checked_buffer_size(buffer_size);
+  InputFile input(input_path, bufsize);
+  OutputFile output(output_path, bufsize);
+
+  z_stream strm{};
+  strm.zalloc = Z_NULL;
+  strm.zfree = Z_NULL;
+  strm.opaque = Z_NULL;
+  strm.avail_in = 0;
+  strm.next_in = Z_NULL;
+  if (inflateInit2(&strm, wbits) != Z_OK) {
+    stop("Failed to initialize decompressor");
+  }
+  StreamGuard guard{&strm, false};
+
+  const uint8_t* data = nullptr;
+  size_t len = 0;
+  int ret = Z_OK;
+  bool finished = false;
+
+  while (input.next(data, len, UINT_MAX)) {
+    strm.next_in = const_cast<Bytef*>(data);
+    strm.avail_in = static_cast<uInt>(len);
+
+    while (strm.avail_in > 0 || ret == Z_OK) {
+      strm.next_out = output.data();
+      strm.avail_out = static_cast<uInt>(output.size());
+      ret = inflate(&strm, Z_NO_FLUSH);
+      if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR || ret == Z_STREAM_ERROR) {
+        Rcpp::Rcerr << "zlib error: " << (strm.msg ? strm.msg : "Unknown error") << std::endl;
+        stop("Decompression failed");
+      }
+      output.write(output.size() - strm.avail_out);
+      finished = ret == Z_STREAM_END;
+
+      if (finished) {
+        if (strm.avail_in == 0) break;
+        inflateReset(&strm);  // Another member follows
+        ret = Z_OK;
+      } else if (strm.avail_out > 0) {
+        break;  // Needs more input
+      }
+    }
+
+    checkUserInterrupt();
+  }
+
+  if (!finished) {
+    stop("Unexpected end of file: " + input_path);
+  }
+
+  output.close();
+  return output.written();
+}
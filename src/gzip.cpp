@@ -0,0 +1,277 @@
+#include <Rcpp.h>
+#include <zlib.h>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include "gzip.h"
+
+using namespace Rcpp;
+
+#ifdef _WIN32
+#define zlib_fseek _fseeki64
+#define zlib_ftell _ftelli64
+#else
+#define zlib_fseek fseeko
+#define zlib_ftell ftello
+#endif
+
+namespace {
+
+const int FTEXT = 0x01;
+const int FHCRC = 0x02;
+const int FEXTRA = 0x04;
+const int FNAME = 0x08;
+const int FCOMMENT = 0x10;
+
+struct FileCloser {
+  FILE* file;
+  ~FileCloser() { if (file) fclose(file); }
+};
+
+uint32_t get_le32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Read a zero terminated header string starting at `pos`. Returns false if it is incomplete.
+bool read_string(const uint8_t* data, size_t len, size_t& pos, std::string& out) {
+  const void* end = std::memchr(data + pos, 0, len - pos);
+  if (!end) {
+    return false;
+  }
+  size_t n = static_cast<const uint8_t*>(end) - (data + pos);
+  out.assign(reinterpret_cast<const char*>(data + pos), n);
+  pos += n + 1;
+  return true;
+}
+
+// Size of the BGZF block starting with this header, from the BC subfield, or 0
+size_t bgzf_block_size(const GzipHeaderInfo& info) {
+  const std::vector<uint8_t>& extra = info.extra;
+  for (size_t pos = 0; pos + 4 <= extra.size();) {
+    size_t sublen = extra[pos + 2] | (extra[pos + 3] << 8);
+    if (extra[pos] == 'B' && extra[pos + 1] == 'C' && sublen == 2 && pos + 6 <= extra.size()) {
+      return static_cast<size_t>(extra[pos + 4] | (extra[pos + 5] << 8)) + 1;
+    }
+    pos += 4 + sublen;
+  }
+  return 0;
+}
+
+}  // namespace
+
+bool parse_gzip_header(const uint8_t* data, size_t len, GzipHeaderInfo& info) {
+  if (len >= 2 && (data[0] != 0x1f || data[1] != 0x8b)) {
+    throw std::runtime_error("Not a gzip header");
+  }
+  if (len < 10) {
+    return false;
+  }
+
+  info = GzipHeaderInfo();
+  info.method = data[2];
+  info.flags = data[3];
+  info.mtime = get_le32(data + 4);
+  info.extra_flags = data[8];
+  info.os = data[9];
+  size_t pos = 10;
+
+  if (info.flags & FEXTRA) {
+    if (len < pos + 2) return false;
+    size_t xlen = data[pos] | (data[pos + 1] << 8);
+    pos += 2;
+    if (len < pos + xlen) return false;
+    info.has_extra = true;
+    info.extra.assign(data + pos, data + pos + xlen);
+    pos += xlen;
+  }
+  if (info.flags & FNAME) {
+    if (!read_string(data, len, pos, info.name)) return false;
+    info.has_name = true;
+  }
+  if (info.flags & FCOMMENT) {
+    if (!read_string(data, len, pos, info.comment)) return false;
+    info.has_comment = true;
+  }
+  if (info.flags & FHCRC) {
+    if (len < pos + 2) return false;
+    pos += 2;
+  }
+
+  info.size = pos;
+  return true;
+}
+
+void read_gzip_header(const List& fields, GzipHeader& header) {
+  header.head = gz_header();
+  header.head.os = 255;  // Unknown, as zlib writes by default
+  if (fields.containsElementNamed("name")) {
+    header.name = as<std::string>(fields["name"]);
+  }
+  if (fields.containsElementNamed("comment")) {
+    header.comment = as<std::string>(fields["comment"]);
+  }
+  if (fields.containsElementNamed("extra")) {
+    RawVector extra = as<RawVector>(fields["extra"]);
+    if (extra.size() > 65535) {
+      stop("The gzip extra field is limited to 65535 bytes");
+    }
+    header.extra.assign(extra.begin(), extra.end());
+  }
+  if (fields.containsElementNamed("mtime")) {
+    header.head.time = static_cast<uLong>(as<double>(fields["mtime"]));  // Seconds since the epoch, also for POSIXct
+  }
+  if (fields.containsElementNamed("os")) {
+    header.head.os = as<int>(fields["os"]);
+  }
+  if (fields.containsElementNamed("text")) {
+    header.head.text = as<bool>(fields["text"]) ? 1 : 0;
+  }
+}
+
+int set_gzip_header(z_stream& strm, GzipHeader& header) {
+  gz_header& head = header.head;
+  head.name = header.name.empty() ? Z_NULL : reinterpret_cast<Bytef*>(&header.name[0]);
+  head.comment = header.comment.empty() ? Z_NULL : reinterpret_cast<Bytef*>(&header.comment[0]);
+  head.extra = header.extra.empty() ? Z_NULL : header.extra.data();
+  head.extra_len = static_cast<uInt>(header.extra.size());
+  return deflateSetHeader(&strm, &head);
+}
+
+//' Inspect a Gzip Header and Trailer
+//'
+//' Read the metadata of gzip data without decompressing it. The header of the first member,
+//' including the optional extra field, file name and comment, is parsed, and the CRC-32 and
+//' uncompressed size are taken from the trailer of the last member. For a file only its
+//' first and last bytes are read.
+//' @param x A raw vector with gzip data, or the path of a gzip file.
+//' @return A list with \code{method}, \code{text}, \code{mtime} (\code{POSIXct}, \code{NA}
+//' if unset), \code{extra_flags}, \code{os}, \code{extra} (raw, \code{NULL} if absent),
+//' \code{name} and \code{comment} (\code{NA} if absent), \code{header_size},
+//' \code{compressed_size}, \code{crc32} and \code{isize} (uncompressed size modulo 2^32 of
+//' the last member), \code{bgzf} and \code{members}. The member count can only be
+//' known without decompressing for BGZF data, whose block headers carry their sizes. It is
+//' \code{NA} otherwise. For BGZF data, the trailers of all blocks are read, and \code{crc32}
+//' and \code{isize} are those of the whole uncompressed data instead of the empty end block.
+//' @examples
+//' compressed_data <- compress(charToRaw("Hello, World"), wbits = 31,
+//'                             header = list(name = "hello.txt", mtime = Sys.time()))
+//' info <- gzip_info(compressed_data)
+//' info$name
+//' info$isize
+//' @export
+// [[Rcpp::export]]
+List gzip_info(SEXP x) {
+  std::vector<uint8_t> head;
+  uint8_t trailer[8];
+  double compressed_size;
+  RawVector data;
+  FILE* file = nullptr;
+
+  if (TYPEOF(x) == RAWSXP) {
+    data = RawVector(x);
+    compressed_size = static_cast<double>(data.size());
+    if (data.size() < 18) {
+      stop("Input is too short to be gzip data");
+    }
+    std::memcpy(trailer, data.end() - 8, 8);
+  } else {
+    std::string path = as<std::string>(x);
+    file = fopen(path.c_str(), "rb");
+    if (!file) {
+      stop("Failed to open file: " + path);
+    }
+  }
+  FileCloser closer{file};
+
+  if (file) {
+    if (zlib_fseek(file, 0, SEEK_END) != 0) {
+      stop("Failed to seek in file");
+    }
+    compressed_size = static_cast<double>(zlib_ftell(file));
+    if (compressed_size < 18 || zlib_fseek(file, -8, SEEK_END) != 0 || fread(trailer, 1, 8, file) != 8) {
+      stop("File is too short to be gzip data");
+    }
+  }
+
+  // Read the header, a file in growing pieces until the strings are complete
+  GzipHeaderInfo info;
+  try {
+    if (file) {
+      size_t wanted = 4096;
+      while (true) {
+        head.resize(wanted);
+        zlib_fseek(file, 0, SEEK_SET);
+        size_t got = fread(head.data(), 1, wanted, file);
+        if (parse_gzip_header(head.data(), got, info)) break;
+        if (got < wanted) throw std::runtime_error("Truncated gzip header");
+        wanted *= 4;
+      }
+    } else if (!parse_gzip_header(data.begin(), static_cast<size_t>(data.size()), info)) {
+      throw std::runtime_error("Truncated gzip header");
+    }
+  } catch (const std::exception& e) {
+    stop(e.what());
+  }
+
+  // BGZF blocks carry their size, so the members can be counted from the headers alone, and
+  // the trailers of all blocks give the CRC-32 and size of the whole uncompressed data
+  double members = NA_REAL;
+  double crc = static_cast<double>(get_le32(trailer));
+  double isize = static_cast<double>(get_le32(trailer + 4));
+  size_t block_size = bgzf_block_size(info);
+  bool bgzf = block_size > 0;
+  if (bgzf) {
+    double count = 0;
+    double offset = 0;
+    uLong combined = crc32(0L, Z_NULL, 0);
+    double total = 0;
+    uint8_t block[18];
+    uint8_t block_trailer[8];
+    while (offset < compressed_size) {
+      if (file) {
+        if (zlib_fseek(file, static_cast<int64_t>(offset), SEEK_SET) != 0 || fread(block, 1, 18, file) != 18) break;
+      } else {
+        if (offset + 18 > compressed_size) break;
+        std::memcpy(block, data.begin() + static_cast<size_t>(offset), 18);
+      }
+      if (block[0] != 0x1f || block[1] != 0x8b || !(block[3] & FEXTRA) || block[12] != 'B' || block[13] != 'C') break;
+      double bsize = (block[16] | (block[17] << 8)) + 1;
+      if (bsize < 26 || offset + bsize > compressed_size) break;
+      if (file) {
+        if (zlib_fseek(file, static_cast<int64_t>(offset + bsize - 8), SEEK_SET) != 0 ||
+            fread(block_trailer, 1, 8, file) != 8) break;
+      } else {
+        std::memcpy(block_trailer, data.begin() + static_cast<size_t>(offset + bsize - 8), 8);
+      }
+      uint32_t block_isize = get_le32(block_trailer + 4);
+      combined = crc32_combine64(combined, get_le32(block_trailer), static_cast<z_off64_t>(block_isize));
+      total += block_isize;
+      offset += bsize;
+      count++;
+    }
+    if (offset == compressed_size) {
+      members = count;
+      crc = static_cast<double>(combined);
+      isize = total;
+    }
+  }
+
+  NumericVector mtime = NumericVector::create(info.mtime == 0 ? NA_REAL : static_cast<double>(info.mtime));
+  mtime.attr("class") = CharacterVector::create("POSIXct", "POSIXt");
+
+  return List::create(
+    Named("method") = info.method,
+    Named("text") = (info.flags & FTEXT) != 0,
+    Named("mtime") = mtime,
+    Named("extra_flags") = info.extra_flags,
+    Named("os") = info.os,
+    Named("extra") = info.has_extra ? SEXP(RawVector(info.extra.begin(), info.extra.end())) : R_NilValue,
+    Named("name") = info.has_name ? CharacterVector::create(info.name) : CharacterVector::create(NA_STRING),
+    Named("comment") = info.has_comment ? CharacterVector::create(info.comment) : CharacterVector::create(NA_STRING),
+    Named("header_size") = static_cast<double>(info.size),
+    Named("compressed_size") = compressed_size,
+    Named("crc32") = crc,
+    Named("isize") = isize,
+    Named("bgzf") = bgzf,
+    Named("members") = members);
+}
@@ -0,0 +1,59 @@
+#ifndef ZLIB_GZIP_H
+#define ZLIB_GZIP_H
+
+#include <Rcpp.h>
+#include <zlib.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Fields of a gzip member header (RFC 1952)
+struct GzipHeaderInfo {
+  int method = 0;
+  int flags = 0;
+  uint32_t mtime = 0;
+  int extra_flags = 0;
+  int os = 0;
+  bool has_extra = false;
+  std::vector<uint8_t> extra;
+  bool has_name = false;
+  std::string name;
+  bool has_comment = false;
+  std::string comment;
+  size_t size = 0;  // Header length in bytes
+};
+
+// Parse the gzip header at the start of `data`. Returns false if `len` bytes do not hold the
+// whole header yet and throws std::runtime_error if `data` is not a gzip header.
+bool parse_gzip_header(const uint8_t* data, size_t len, GzipHeaderInfo& info);
+
+// Uncompressed size announced by a gzip trailer, or 0 if `data` is not a plausible
+// single gzip member. ISIZE is the size modulo 2^32 and deflate cannot expand more than
+// 1032:1, which bounds how far it can be trusted.
+inline size_t gzip_isize(const uint8_t* data, size_t len) {
+  if (len < 18 || data[0] != 0x1f || data[1] != 0x8b) {
+    return 0;
+  }
+  const uint8_t* trailer = data + len - 4;
+  size_t isize = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | (static_cast<size_t>(trailer[3]) << 24);
+  return isize <= len * 1032 ? isize : 0;
+}
+
+// Header fields a compressor writes with deflateSetHeader(). zlib only keeps pointers to the
+// strings until the header is written, so they are owned here, next to the stream.
+struct GzipHeader {
+  std::string name;
+  std::string comment;
+  std::vector<uint8_t> extra;
+  gz_header head{};
+};
+
+// Read the header fields from an R list with the optional elements name, comment, mtime,
+// os, extra and text.
+void read_gzip_header(const Rcpp::List& fields, GzipHeader& header);
+
+// Hand the header to a freshly initialized or reset gzip deflate stream.
+int set_gzip_header(z_stream& strm, GzipHeader& header);
+
+#endif // ZLIB_GZIP_H
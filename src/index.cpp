@@ -0,0 +1,438 @@
+#include <Rcpp.h>
+#include <zlib.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+using namespace Rcpp;
+
+#ifdef _WIN32
+#define zlib_fseek _fseeki64
+typedef __int64 zlib_off_t;
+#else
+#define zlib_fseek fseeko
+typedef off_t zlib_off_t;
+#endif
+
+namespace {
+
+const size_t WINSIZE = 32768;    // Sliding window size of deflate
+const size_t CHUNK = 262144;     // File input buffer size
+const char INDEX_MAGIC[8] = {'Z', 'R', 'A', 'N', 'I', 'D', 'X', '1'};
+
+// An access point: the inflate state can be rebuilt here from the bit offset and window.
+struct AccessPoint {
+  int64_t out;                   // Uncompressed offset of the point
+  int64_t in;                    // Compressed offset of the first full byte
+  int bits;                      // Number of bits (1-7) of the byte before `in` to prime, or 0
+  std::vector<uint8_t> window;   // Preceding 32 KiB of output, deflated to keep the index small
+};
+
+struct GzipIndex {
+  int64_t span = 0;
+  int64_t compressed_size = 0;
+  int64_t uncompressed_size = 0;
+  std::vector<AccessPoint> points;
+};
+
+struct FileCloser {
+  FILE* file;
+  ~FileCloser() { if (file) fclose(file); }
+};
+
+struct InflateEnder {
+  z_stream* strm;
+  ~InflateEnder() { inflateEnd(strm); }
+};
+
+void add_point(GzipIndex& index, int bits, int64_t in, int64_t out, size_t left, const uint8_t* window) {
+  // Unroll the circular output buffer into the 32 KiB that precede this point
+  std::vector<uint8_t> flat(WINSIZE);
+  if (left) {
+    std::memcpy(flat.data(), window + WINSIZE - left, left);
+  }
+  if (left < WINSIZE) {
+    std::memcpy(flat.data() + left, window, WINSIZE - left);
+  }
+
+  AccessPoint point;
+  point.bits = bits;
+  point.in = in;
+  point.out = out;
+  uLongf packed = compressBound(WINSIZE);
+  point.window.resize(packed);
+  if (compress2(point.window.data(), &packed, flat.data(), WINSIZE, Z_BEST_SPEED) != Z_OK) {
+    stop("Failed to store access point window");
+  }
+  point.window.resize(packed);
+  index.points.push_back(std::move(point));
+}
+
+std::vector<uint8_t> point_window(const AccessPoint& point) {
+  std::vector<uint8_t> window(WINSIZE);
+  uLongf size = WINSIZE;
+  if (uncompress(window.data(), &size, point.window.data(), point.window.size()) != Z_OK || size != WINSIZE) {
+    stop("Corrupt access point window in index");
+  }
+  return window;
+}
+
+bool is_gzip_member(FILE* file, z_stream& strm, std::vector<uint8_t>& in) {
+  // Top up the input so the two magic bytes of a following member can be checked
+  if (strm.avail_in < 2) {
+    std::memmove(in.data(), strm.next_in, strm.avail_in);
+    strm.next_in = in.data();
+    strm.avail_in += fread(in.data() + strm.avail_in, 1, in.size() - strm.avail_in, file);
+  }
+  return strm.avail_in >= 2 && strm.next_in[0] == 0x1f && strm.next_in[1] == 0x8b;
+}
+
+XPtr<GzipIndex> load_index(const std::string& index_path) {
+  FILE* file = fopen(index_path.c_str(), "rb");
+  if (!file) {
+    stop("Failed to open index file: " + index_path);
+  }
+  FileCloser closer{file};
+
+  auto read_i64 = [&](int64_t& value) {
+    uint8_t buf[8];
+    if (fread(buf, 1, 8, file) != 8) stop("Truncated index file: " + index_path);
+    value = 0;
+    for (int i = 7; i >= 0; i--) value = (value << 8) | buf[i];
+  };
+
+  char magic[8];
+  if (fread(magic, 1, 8, file) != 8 || std::memcmp(magic, INDEX_MAGIC, 8) != 0) {
+    stop("Not a gzip index file: " + index_path);
+  }
+
+  GzipIndex* index = new GzipIndex();
+  XPtr<GzipIndex> ptr(index, true);
+  int64_t count;
+  read_i64(index->span);
+  read_i64(index->compressed_size);
+  read_i64(index->uncompressed_size);
+  read_i64(count);
+  if (count < 0) {
+    stop("Corrupt index file: " + index_path);
+  }
+
+  index->points.resize(count);
+  for (auto& point : index->points) {
+    int64_t bits, size;
+    read_i64(point.in);
+    read_i64(point.out);
+    read_i64(bits);
+    read_i64(size);
+    if (bits < 0 || bits > 7 || size <= 0 || size > static_cast<int64_t>(compressBound(WINSIZE))) {
+      stop("Corrupt index file: " + index_path);
+    }
+    point.bits = static_cast<int>(bits);
+    point.window.resize(size);
+    if (fread(point.window.data(), 1, size, file) != static_cast<size_t>(size)) {
+      stop("Truncated index file: " + index_path);
+    }
+  }
+
+  return ptr;
+}
+
+}  // namespace
+
+//' Build a Random-Access Index for a Gzip File
+//'
+//' Inflate a gzip (or zlib) file once and record an access point roughly every
+//' \code{span} uncompressed bytes, as in zlib's zran example. Each access point holds the
+//' compressed bit offset, the uncompressed offset and the preceding 32 KiB window, so
+//' \code{gz_read_range()} can later start inflating there instead of at byte 0.
+//' Concatenated gzip members are followed. The windows are kept deflated.
+//' @param file_path A string representing the path of the gzip file to index.
+//' @param span Minimum distance between access points in uncompressed bytes. Default is 1 MiB.
+//' @return An external pointer to the index, to be used with \code{gz_read_range()} and
+//'         \code{save_gzip_index()}.
+//' @examples
+//' temp_file <- tempfile(fileext = ".gz")
+//' writeBin(compress(charToRaw(strrep("Hello, World ", 100000)), wbits = 31), temp_file)
+//' index <- build_gzip_index(temp_file, span = 65536)
+//' rawToChar(gz_read_range(temp_file, 650000, 12, index))
+//' @export
+// [[Rcpp::export]]
+SEXP build_gzip_index(const std::string& file_path, double span = 1048576) {
+  if (span < 1) {
+    stop("span must be positive");
+  }
+
+  FILE* file = fopen(file_path.c_str(), "rb");
+  if (!file) {
+    stop("Failed to open file: " + file_path);
+  }
+  FileCloser closer{file};
+
+  z_stream strm{};
+  strm.zalloc = Z_NULL;
+  strm.zfree = Z_NULL;
+  strm.opaque = Z_NULL;
+  strm.avail_in = 0;
+  strm.next_in = Z_NULL;
+  if (inflateInit2(&strm, 15 + 32) != Z_OK) {  // Automatic zlib or gzip header detection
+    stop("Failed to initialize decompressor");
+  }
+  InflateEnder ender{&strm};
+
+  GzipIndex* index = new GzipIndex();
+  XPtr<GzipIndex> ptr(index, true);
+  index->span = static_cast<int64_t>(span);
+
+  std::vector<uint8_t> in(CHUNK);
+  std::vector<uint8_t> window(WINSIZE);
+  int64_t totin = 0, totout = 0, last = 0;
+  int ret = Z_OK;
+
+  strm.avail_out = 0;
+  do {
+    if (strm.avail_in == 0) {
+      strm.avail_in = fread(in.data(), 1, CHUNK, file);
+      if (ferror(file)) {
+        stop("File read error: " + file_path);
+      }
+      if (strm.avail_in == 0) {
+        stop("Unexpected end of file: " + file_path);
+      }
+      strm.next_in = in.data();
+    }
+
+    do {
+      if (strm.avail_out == 0) {
+        strm.avail_out = WINSIZE;
+        strm.next_out = window.data();
+      }
+
+      // Stop at the end of every deflate block (Z_BLOCK) to find candidate access points
+      totin += strm.avail_in;
+      totout += strm.avail_out;
+      ret = inflate(&strm, Z_BLOCK);
+      totin -= strm.avail_in;
+      totout -= strm.avail_out;
+
+      if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR || ret == Z_STREAM_ERROR) {
+        stop(std::string("zlib error: ") + (strm.msg ? strm.msg : zError(ret)));
+      }
+      if (ret == Z_STREAM_END) {
+        break;
+      }
+
+      // A block boundary that is not the end of the stream is a valid access point
+      if ((strm.data_type & 128) && !(strm.data_type & 64) && (totout == 0 || totout - last > index->span)) {
+        add_point(*index, strm.data_type & 7, totin, totout, strm.avail_out, window.data());
+        last = totout;
+      }
+    } while (strm.avail_in != 0);
+
+    // Follow concatenated gzip members, anything else after the trailer is ignored
+    if (ret == Z_STREAM_END && is_gzip_member(file, strm, in)) {
+      inflateReset(&strm);
+      ret = Z_OK;
+    }
+  } while (ret != Z_STREAM_END);
+
+  index->compressed_size = totin;
+  index->uncompressed_size = totout;
+  return ptr;
+}
+
+//' Save a Gzip Index to a Sidecar File
+//'
+//' Write an index created by \code{build_gzip_index()} to a compact binary file.
+//' @param index An external pointer to a gzip index.
+//' @param index_path A string representing the path of the index file to write.
+//' @return No return value, called for side effect.
+//' @examples
+//' temp_file <- tempfile(fileext = ".gz")
+//' writeBin(compress(charToRaw(strrep("Hello, World ", 100000)), wbits = 31), temp_file)
+//' save_gzip_index(build_gzip_index(temp_file, span = 65536), paste0(temp_file, ".idx"))
+//' @export
+// [[Rcpp::export]]
+void save_gzip_index(SEXP index, const std::string& index_path) {
+  XPtr<GzipIndex> ptr(index);
+  if (!ptr) {
+    stop("Invalid gzip index object");
+  }
+
+  FILE* file = fopen(index_path.c_str(), "wb");
+  if (!file) {
+    stop("Failed to open index file: " + index_path);
+  }
+  FileCloser closer{file};
+
+  std::vector<uint8_t> out(INDEX_MAGIC, INDEX_MAGIC + 8);
+  auto put_i64 = [&](int64_t value) {
+    for (int i = 0; i < 8; i++) out.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i)));
+  };
+  put_i64(ptr->span);
+  put_i64(ptr->compressed_size);
+  put_i64(ptr->uncompressed_size);
+  put_i64(static_cast<int64_t>(ptr->points.size()));
+  for (const auto& point : ptr->points) {
+    put_i64(point.in);
+    put_i64(point.out);
+    put_i64(point.bits);
+    put_i64(static_cast<int64_t>(point.window.size()));
+    out.insert(out.end(), point.window.begin(), point.window.end());
+  }
+
+  if (fwrite(out.data(), 1, out.size(), file) != out.size()) {
+    stop("Failed to write index file: " + index_path);
+  }
+}
+
+//' Load a Gzip Index from a Sidecar File
+//'
+//' Read an index previously written by \code{save_gzip_index()}.
+//' @param index_path A string representing the path of the index file.
+//' @return An external pointer to the index.
+//' @examples
+//' temp_file <- tempfile(fileext = ".gz")
+//' writeBin(compress(charToRaw(strrep("Hello, World ", 100000)), wbits = 31), temp_file)
+//' save_gzip_index(build_gzip_index(temp_file, span = 65536), paste0(temp_file, ".idx"))
+//' index <- load_gzip_index(paste0(temp_file, ".idx"))
+//' @export
+// [[Rcpp::export]]
+SEXP load_gzip_index(const std::string& index_path) {
+  return load_index(index_path);
+}
+
+//' Read a Range of Uncompressed Bytes from a Gzip File
+//'
+//' Extract \code{length} uncompressed bytes starting at \code{offset} without inflating
+//' the file from the start. The inflater is primed at the closest access point before
+//' \code{offset}, so the cost is proportional to the span of the index, not the file size.
+//' @param file_path A string representing the path of the gzip file.
+//' @param offset Uncompressed byte offset to start reading at (0-based).
+//' @param length Number of uncompressed bytes to read.
+//' @param index An index created by \code{build_gzip_index()} or \code{load_gzip_index()},
+//'        or the path of an index file written by \code{save_gzip_index()}.
+//' @return A raw vector with up to \code{length} bytes, shorter if the end of the data is reached.
+//' @examples
+//' temp_file <- tempfile(fileext = ".gz")
+//' writeBin(compress(charToRaw(strrep("Hello, World ", 100000)), wbits = 31), temp_file)
+//' index <- build_gzip_index(temp_file, span = 65536)
+//' rawToChar(gz_read_range(temp_file, 650000, 12, index))
+//' @export
+// [[Rcpp::export]]
+RawVector gz_read_range(const std::string& file_path, double offset, double length, SEXP index) {
+  if (offset < 0 || length < 0) {
+    stop("offset and length must not be negative");
+  }
+
+  XPtr<GzipIndex> ptr = TYPEOF(index) == STRSXP ? load_index(as<std::string>(index)) : XPtr<GzipIndex>(index);
+  if (!ptr) {
+    stop("Invalid gzip index object");
+  }
+
+  int64_t start = static_cast<int64_t>(offset);
+  if (ptr->points.empty() || start >= ptr->uncompressed_size || length == 0) {
+    return RawVector::create();
+  }
+  size_t len = static_cast<size_t>(std::min(static_cast<double>(ptr->uncompressed_size - start), length));
+
+  // Last access point at or before the requested offset
+  auto point = std::upper_bound(ptr->points.begin(), ptr->points.end(), start,
+                                [](int64_t value, const AccessPoint& p) { return value < p.out; });
+  const AccessPoint& here = *(point - 1);
+
+  FILE* file = fopen(file_path.c_str(), "rb");
+  if (!file) {
+    stop("Failed to open file: " + file_path);
+  }
+  FileCloser closer{file};
+
+  z_stream strm{};
+  strm.zalloc = Z_NULL;
+  strm.zfree = Z_NULL;
+  strm.opaque = Z_NULL;
+  strm.avail_in = 0;
+  strm.next_in = Z_NULL;
+  if (inflateInit2(&strm, -15) != Z_OK) {  // Raw inflate, the point is inside deflate data
+    stop("Failed to initialize decompressor");
+  }
+  InflateEnder ender{&strm};
+
+  if (zlib_fseek(file, static_cast<zlib_off_t>(here.in - (here.bits ? 1 : 0)), SEEK_SET) != 0) {
+    stop("Failed to seek in file: " + file_path);
+  }
+  if (here.bits) {
+    int byte = getc(file);
+    if (byte == EOF) {
+      stop("Unexpected end of file: " + file_path);
+    }
+    inflatePrime(&strm, here.bits, byte >> (8 - here.bits));
+  }
+  std::vector<uint8_t> window = point_window(here);
+  inflateSetDictionary(&strm, window.data(), WINSIZE);
+
+  RawVector result(len);
+  std::vector<uint8_t> in(CHUNK);
+  int64_t skip = start - here.out;
+  size_t got = 0;
+  bool discarding = false;
+  bool done = false;
+
+  while (!done && got < len) {
+    if (strm.avail_out == 0) {
+      discarding = skip > 0;
+      if (discarding) {
+        // Discard output up to the requested offset, reusing the window as scratch space
+        size_t n = static_cast<size_t>(std::min<int64_t>(skip, WINSIZE));
+        strm.next_out = window.data();
+        strm.avail_out = static_cast<uInt>(n);
+        skip -= n;
+      } else {
+        // Inflate straight into the result, in pieces that fit avail_out
+        strm.next_out = result.begin() + got;
+        strm.avail_out = static_cast<uInt>(std::min<size_t>(len - got, 1UL << 30));
+      }
+    }
+
+    if (strm.avail_in == 0) {
+      strm.avail_in = fread(in.data(), 1, CHUNK, file);
+      if (ferror(file)) {
+        stop("File read error: " + file_path);
+      }
+      if (strm.avail_in == 0) {
+        stop("Unexpected end of file: " + file_path);
+      }
+      strm.next_in = in.data();
+    }
+
+    uInt before = strm.avail_out;
+    int ret = inflate(&strm, Z_NO_FLUSH);
+    if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR || ret == Z_STREAM_ERROR) {
+      stop(std::string("zlib error: ") + (strm.msg ? strm.msg : zError(ret)));
+    }
+    if (!discarding) {
+      got += before - strm.avail_out;
+    }
+
+    if (ret == Z_STREAM_END) {
+      // Skip the 8 byte gzip trailer and continue with the next member, if any
+      for (int i = 0; i < 8; i++) {
+        if (strm.avail_in == 0) {
+          strm.avail_in = fread(in.data(), 1, CHUNK, file);
+          strm.next_in = in.data();
+        }
+        if (strm.avail_in == 0) break;
+        strm.next_in++;
+        strm.avail_in--;
+      }
+      done = !is_gzip_member(file, strm, in);
+      if (!done) {
+        inflateReset2(&strm, 15 + 16);
+      }
+    }
+  }
+
+  if (got < len) {
+    return RawVector(result.begin(), result.begin() + got);
+  }
+  return result;
+}
@@ -0,0 +1,99 @@
+#ifndef ZLIB_INPUT_FILE_H
+#define ZLIB_INPUT_FILE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Sequential read access to a whole file. On POSIX systems the file is memory mapped so
+// zlib reads it straight from the page cache, elsewhere it falls back to buffered reads.
+// Errors are thrown as std::runtime_error, so it can also be used on worker threads.
+class InputFile {
+public:
+  InputFile(const std::string& path, size_t buffer_size) : path_(path) {
+#ifndef _WIN32
+    (void) buffer_size;
+    fd_ = open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+      throw std::runtime_error("Failed to open file: " + path);
+    }
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+      close(fd_);
+      throw std::runtime_error("Failed to stat file: " + path);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+      void* map = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+      if (map == MAP_FAILED) {
+        close(fd_);
+        throw std::runtime_error("Failed to map file: " + path);
+      }
+      map_ = static_cast<const uint8_t*>(map);
+      madvise(map, size_, MADV_SEQUENTIAL);
+    }
+#else
+    file_ = fopen(path.c_str(), "rb");
+    if (!file_) {
+      throw std::runtime_error("Failed to open file: " + path);
+    }
+    _fseeki64(file_, 0, SEEK_END);
+    size_ = static_cast<size_t>(_ftelli64(file_));
+    _fseeki64(file_, 0, SEEK_SET);
+    buffer_.resize(buffer_size);
+#endif
+  }
+
+  ~InputFile() {
+#ifndef _WIN32
+    if (map_) munmap(const_cast<uint8_t*>(map_), size_);
+    if (fd_ >= 0) close(fd_);
+#else
+    if (file_) fclose(file_);
+#endif
+  }
+
+  // Hand out the next window of input, at most `max` bytes. Returns false at end of file.
+  bool next(const uint8_t*& data, size_t& len, size_t max) {
+#ifndef _WIN32
+    if (pos_ >= size_) return false;
+    data = map_ + pos_;
+    len = std::min(size_ - pos_, max);
+    pos_ += len;
+    return true;
+#else
+    len = fread(buffer_.data(), 1, std::min(buffer_.size(), max), file_);
+    if (ferror(file_)) {
+      throw std::runtime_error("File read error: " + path_);
+    }
+    data = buffer_.data();
+    return len > 0;
+#endif
+  }
+
+  size_t size() const { return size_; }
+
+private:
+  std::string path_;
+  size_t size_ = 0;
+#ifndef _WIN32
+  int fd_ = -1;
+  const uint8_t* map_ = nullptr;
+  size_t pos_ = 0;
+#else
+  FILE* file_ = nullptr;
+  std::vector<uint8_t> buffer_;
+#endif
+};
+
+#endif // ZLIB_INPUT_FILE_H
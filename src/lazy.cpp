@@ -0,0 +1,391 @@
+#include <Rcpp.h>
+#include <zlib.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <memory>
+#include "compressor.h"
+#include "decompressor.h"
+#include "pool.h"
+
+// R_ext/Altrep.h of R < 4.0 names function parameters `class` and has no C++ guard
+#define class class_name
+extern "C" {
+#include <R_ext/Altrep.h>
+}
+#undef class
+
+using namespace Rcpp;
+
+namespace {
+
+// Independently deflated blocks of a vector. Never modified once built, so duplicates of a
+// lazy vector share them.
+struct LazyBlocks {
+  size_t length = 0;
+  size_t block_size = 0;
+  std::vector<std::vector<uint8_t>> blocks;  // Raw deflate, block i holds [i * block_size, ...)
+  size_t compressed_size = 0;
+};
+
+// State behind a lazy raw vector: the blocks and a small LRU cache of inflated blocks
+struct LazyRaw {
+  std::shared_ptr<const LazyBlocks> data;
+  size_t cache_blocks = 4;
+  std::list<std::pair<size_t, std::vector<uint8_t>>> cache;  // Most recently used first
+  PooledDecompressor inflater;
+};
+
+R_altrep_class_t lazy_raw_class;
+
+// Split `len` bytes into blocks on a raw deflate compressor, one complete stream per block
+class BlockWriter {
+public:
+  BlockWriter(size_t block_size, int level)
+      : blocks_(new LazyBlocks()), compressor_(acquire_compressor(level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY)) {
+    blocks_->block_size = block_size;
+    compress_totals.streams.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void add(const uint8_t* in, size_t len) {
+    StatsScope scope(compressor_->stats, compress_totals);
+    size_t produced = deflate_into(*compressor_, in, len, Z_FINISH);
+    end_stream(*compressor_);
+    const uint8_t* out = compressor_->buffer.data();
+    blocks_->blocks.emplace_back(out, out + produced);
+    blocks_->length += len;
+    blocks_->compressed_size += produced;
+  }
+
+  std::shared_ptr<const LazyBlocks> finish() { return std::move(blocks_); }
+
+private:
+  std::shared_ptr<LazyBlocks> blocks_;
+  PooledCompressor compressor_;
+};
+
+size_t block_length(const LazyBlocks& data, size_t i) {
+  return std::min(data.block_size, data.length - i * data.block_size);
+}
+
+// The inflated block `i`, from the cache or inflated into it
+const std::vector<uint8_t>& load_block(LazyRaw& lazy, size_t i) {
+  auto& cache = lazy.cache;
+  for (auto it = cache.begin(); it != cache.end(); ++it) {
+    if (it->first == i) {
+      if (it != cache.begin()) {
+        cache.splice(cache.begin(), cache, it);
+      }
+      return cache.front().second;
+    }
+  }
+
+  std::vector<uint8_t> block;
+  if (cache.size() >= lazy.cache_blocks) {
+    block.swap(cache.back().second);  // Reuse the evicted block's memory
+    cache.pop_back();
+  }
+  if (!lazy.inflater) {
+    lazy.inflater = acquire_decompressor(-MAX_WBITS);
+    decompress_totals.streams.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  const LazyBlocks& data = *lazy.data;
+  size_t size = block_length(data, i);
+  const std::vector<uint8_t>& in = data.blocks[i];
+  block.resize(size);
+  size_t produced = 0;
+  {
+    StatsScope scope(lazy.inflater->stats, decompress_totals);
+    inflate_into(*lazy.inflater, in.data(), in.size(), block, produced, size);
+  }
+  if (produced != size) {
+    reset_decompressor(*lazy.inflater);
+    stop("Corrupt block in lazy raw vector");
+  }
+  cache.emplace_front(i, std::move(block));
+  return cache.front().second;
+}
+
+// Copy [start, start + n) to `buf`, inflating only the blocks it touches
+void read_range(LazyRaw& lazy, size_t start, size_t n, uint8_t* buf) {
+  size_t bsize = lazy.data->block_size;
+  while (n > 0) {
+    size_t i = start / bsize;
+    size_t offset = start - i * bsize;
+    const std::vector<uint8_t>& block = load_block(lazy, i);
+    size_t take = std::min(n, block.size() - offset);
+    std::memcpy(buf, block.data() + offset, take);
+    buf += take;
+    start += take;
+    n -= take;
+  }
+}
+
+LazyRaw& lazy_state(SEXP x) {
+  return *static_cast<LazyRaw*>(R_ExternalPtrAddr(R_altrep_data1(x)));
+}
+
+bool materialized(SEXP x) {
+  return R_altrep_data2(x) != R_NilValue;
+}
+
+SEXP new_lazy_raw(std::shared_ptr<const LazyBlocks> data, size_t cache_blocks) {
+  XPtr<LazyRaw> state(new LazyRaw(), true);
+  state->data = std::move(data);
+  state->cache_blocks = std::max<size_t>(cache_blocks, 1);
+  return R_new_altrep(lazy_raw_class, state, R_NilValue);
+}
+
+// ALTREP methods are called from R's C code, so errors are turned into R errors only after
+// the C++ frames are unwound
+template <typename F>
+auto guarded(F fn) -> decltype(fn()) {
+  char message[512];
+  try {
+    return fn();
+  } catch (std::exception& e) {
+    std::snprintf(message, sizeof(message), "%s", e.what());
+  }
+  Rf_error("%s", message);
+}
+
+R_xlen_t lazy_length(SEXP x) {
+  return static_cast<R_xlen_t>(lazy_state(x).data->length);
+}
+
+Rboolean lazy_inspect(SEXP x, int, int, int, void (*)(SEXP, int, int, int)) {
+  const LazyBlocks& data = *lazy_state(x).data;
+  Rprintf(" zlib lazy raw (length %.0f, %.0f blocks of %.0f bytes, %.0f bytes compressed%s)\n",
+          static_cast<double>(data.length), static_cast<double>(data.blocks.size()),
+          static_cast<double>(data.block_size), static_cast<double>(data.compressed_size),
+          materialized(x) ? ", materialized" : "");
+  return TRUE;
+}
+
+// Full access inflates everything once. The vector may be written through the pointer,
+// so from then on all access goes to the inflated copy.
+void* lazy_dataptr(SEXP x, Rboolean) {
+  if (!materialized(x)) {
+    LazyRaw& lazy = lazy_state(x);
+    SEXP full = PROTECT(Rf_allocVector(RAWSXP, static_cast<R_xlen_t>(lazy.data->length)));
+    guarded([&]() { read_range(lazy, 0, lazy.data->length, RAW(full)); });
+    R_set_altrep_data2(x, full);
+    UNPROTECT(1);
+    lazy.cache.clear();
+  }
+  return RAW(R_altrep_data2(x));
+}
+
+const void* lazy_dataptr_or_null(SEXP x) {
+  return materialized(x) ? RAW(R_altrep_data2(x)) : nullptr;
+}
+
+Rbyte lazy_elt(SEXP x, R_xlen_t i) {
+  if (materialized(x)) {
+    return RAW(R_altrep_data2(x))[i];
+  }
+  LazyRaw& lazy = lazy_state(x);
+  size_t bsize = lazy.data->block_size;
+  size_t index = static_cast<size_t>(i);
+  return guarded([&]() { return load_block(lazy, index / bsize)[index % bsize]; });
+}
+
+R_xlen_t lazy_get_region(SEXP x, R_xlen_t start, R_xlen_t size, Rbyte* buf) {
+  R_xlen_t n = std::min(size, lazy_length(x) - start);
+  if (n <= 0) {
+    return 0;
+  }
+  if (materialized(x)) {
+    std::memcpy(buf, RAW(R_altrep_data2(x)) + start, static_cast<size_t>(n));
+  } else {
+    LazyRaw& lazy = lazy_state(x);
+    guarded([&]() { read_range(lazy, static_cast<size_t>(start), static_cast<size_t>(n), buf); });
+  }
+  return n;
+}
+
+// Copies share the compressed blocks and only get a cache of their own
+SEXP lazy_duplicate(SEXP x, Rboolean) {
+  if (materialized(x)) {
+    return nullptr;  // Modified or fully inflated: R copies the inflated data
+  }
+  LazyRaw& lazy = lazy_state(x);
+  return new_lazy_raw(lazy.data, lazy.cache_blocks);
+}
+
+// Saved and serialized as the compressed blocks, unless the vector has been materialized
+SEXP lazy_serialized_state(SEXP x) {
+  if (materialized(x)) {
+    return nullptr;
+  }
+  const LazyRaw& lazy = lazy_state(x);
+  const LazyBlocks& data = *lazy.data;
+  SEXP blocks = PROTECT(Rf_allocVector(VECSXP, static_cast<R_xlen_t>(data.blocks.size())));
+  for (size_t i = 0; i < data.blocks.size(); i++) {
+    SEXP block = Rf_allocVector(RAWSXP, static_cast<R_xlen_t>(data.blocks[i].size()));
+    SET_VECTOR_ELT(blocks, static_cast<R_xlen_t>(i), block);
+    std::memcpy(RAW(block), data.blocks[i].data(), data.blocks[i].size());
+  }
+  SEXP state = PROTECT(Rf_allocVector(VECSXP, 4));
+  SET_VECTOR_ELT(state, 0, Rf_ScalarReal(static_cast<double>(data.length)));
+  SET_VECTOR_ELT(state, 1, Rf_ScalarReal(static_cast<double>(data.block_size)));
+  SET_VECTOR_ELT(state, 2, Rf_ScalarReal(static_cast<double>(lazy.cache_blocks)));
+  SET_VECTOR_ELT(state, 3, blocks);
+  UNPROTECT(2);
+  return state;
+}
+
+SEXP lazy_unserialize(SEXP, SEXP state) {
+  std::shared_ptr<LazyBlocks> data(new LazyBlocks());
+  data->length = static_cast<size_t>(REAL(VECTOR_ELT(state, 0))[0]);
+  data->block_size = static_cast<size_t>(REAL(VECTOR_ELT(state, 1))[0]);
+  SEXP blocks = VECTOR_ELT(state, 3);
+  for (R_xlen_t i = 0; i < XLENGTH(blocks); i++) {
+    SEXP block = VECTOR_ELT(blocks, i);
+    data->blocks.emplace_back(RAW(block), RAW(block) + XLENGTH(block));
+    data->compressed_size += static_cast<size_t>(XLENGTH(block));
+  }
+  return new_lazy_raw(data, static_cast<size_t>(REAL(VECTOR_ELT(state, 2))[0]));
+}
+
+void check_block_size(double block_size) {
+  if (block_size < 1024) {
+    stop("block_size must be at least 1024 bytes");
+  }
+  if (block_size > 1073741824.0) {
+    stop("block_size must not exceed 1 GiB");
+  }
+}
+
+}  // namespace
+
+// [[Rcpp::init]]
+void init_lazy_raw(DllInfo* dll) {
+  lazy_raw_class = R_make_altraw_class("lazy_raw", "zlib", dll);
+  R_set_altrep_Length_method(lazy_raw_class, lazy_length);
+  R_set_altrep_Inspect_method(lazy_raw_class, lazy_inspect);
+  R_set_altrep_Duplicate_method(lazy_raw_class, lazy_duplicate);
+  R_set_altrep_Serialized_state_method(lazy_raw_class, lazy_serialized_state);
+  R_set_altrep_Unserialize_method(lazy_raw_class, lazy_unserialize);
+  R_set_altvec_Dataptr_method(lazy_raw_class, lazy_dataptr);
+  R_set_altvec_Dataptr_or_null_method(lazy_raw_class, lazy_dataptr_or_null);
+  R_set_altraw_Elt_method(lazy_raw_class, lazy_elt);
+  R_set_altraw_Get_region_method(lazy_raw_class, lazy_get_region);
+}
+
+//' Create a Lazily Decompressed Raw Vector
+//'
+//' Store a raw vector as independently deflated blocks behind an ALTREP raw vector. It
+//' behaves like the original vector, but element and range access (\code{x[i]},
+//' \code{x[a:b]}, \code{readBin()}) inflate only the blocks they touch, keeping the last
+//' \code{cache_blocks} inflated blocks in an LRU cache. Code that needs a pointer to the
+//' whole vector, or modifies it, inflates it once in full. Copies share the compressed blocks,
+//' and \code{saveRDS()} / \code{serialize()} write the compressed blocks.
+//' @param data A raw vector.
+//' @param block_size Uncompressed size of each block in bytes. Default is 64 KiB.
+//' @param level Compression level, integer between 0 and 9, or -1 for default.
+//' @param cache_blocks Number of inflated blocks kept in the cache. Default is 4.
+//' @return A raw vector.
+//' @examples
+//' data <- charToRaw(strrep("Hello, World. ", 100000))
+//' x <- lazy_raw(data)
+//' identical(x[700001:700012], data[700001:700012])
+//' lazy_raw_info(x)$compressed_size
+//' @export
+// [[Rcpp::export]]
+SEXP lazy_raw(const RawVector& data, double block_size = 65536, int level = -1, int cache_blocks = 4) {
+  check_block_size(block_size);
+  size_t bsize = static_cast<size_t>(block_size);
+  BlockWriter writer(bsize, level);
+  const uint8_t* in = data.begin();
+  size_t total = static_cast<size_t>(data.size());
+  for (size_t start = 0; start < total; start += bsize) {
+    writer.add(in + start, std::min(bsize, total - start));
+  }
+  return new_lazy_raw(writer.finish(), static_cast<size_t>(std::max(cache_blocks, 1)));
+}
+
+//' Decompress into a Lazily Decompressed Raw Vector
+//'
+//' Inflate a zlib, gzip or raw deflate stream one block at a time and store every block
+//' deflated on its own, as \code{lazy_raw()} does. Only one block is ever inflated in full, so
+//' large payloads can be decompressed, handed around and sliced without their full size in
+//' memory. Used by \code{decompress(lazy = TRUE)}.
+//' @param data A raw vector containing the compressed data.
+//' @param wbits The window size bits parameter. Default is 0.
+//' @param zdict Optional predefined dictionary as a raw vector.
+//' @param block_size Uncompressed size of each block in bytes. Default is 64 KiB.
+//' @param level Compression level of the blocks, integer between 0 and 9, or -1 for default.
+//' @param cache_blocks Number of inflated blocks kept in the cache. Default is 4.
+//' @return A raw vector, see \code{lazy_raw()}.
+//' @examples
+//' compressed_data <- compress(charToRaw(strrep("Hello, World. ", 100000)))
+//' x <- decompress_lazy(compressed_data)
+//' rawToChar(x[1:12])
+//' @export
+// [[Rcpp::export]]
+SEXP decompress_lazy(const RawVector& data, int wbits = 0, Nullable<RawVector> zdict = R_NilValue,
+                     double block_size = 65536, int level = -1, int cache_blocks = 4) {
+  check_block_size(block_size);
+  size_t bsize = static_cast<size_t>(block_size);
+
+  PooledDecompressor decompressor = acquire_decompressor(wbits);
+  decompress_totals.streams.fetch_add(1, std::memory_order_relaxed);
+  if (zdict.isNotNull()) {
+    RawVector dictVec(zdict);
+    decompressor->zdict.assign(dictVec.begin(), dictVec.end());
+    reset_decompressor(*decompressor);  // Sets a raw deflate dictionary up front
+  }
+
+  BlockWriter writer(bsize, level);
+  const uint8_t* in = data.begin();
+  size_t in_len = static_cast<size_t>(data.size());
+  size_t consumed = 0;
+  size_t produced = 0;
+  std::vector<uint8_t> block;
+  while (true) {
+    {
+      StatsScope scope(decompressor->stats, decompress_totals);
+      consumed += inflate_into(*decompressor, in + consumed, in_len - consumed, block, produced, bsize);
+    }
+    if (produced < bsize) {
+      break;  // All input used; a truncated stream keeps what was decompressed
+    }
+    writer.add(block.data(), bsize);
+    produced = 0;
+  }
+  if (produced > 0) {
+    writer.add(block.data(), produced);
+  }
+  return new_lazy_raw(writer.finish(), static_cast<size_t>(std::max(cache_blocks, 1)));
+}
+
+//' Describe a Lazily Decompressed Raw Vector
+//'
+//' Report how a lazy raw vector is stored and how much of it is currently inflated.
+//' @param x A raw vector created by \code{lazy_raw()} or \code{decompress(lazy = TRUE)}.
+//' @return A list with \code{length}, \code{block_size}, \code{blocks},
+//' \code{compressed_size} (bytes held by the compressed blocks), \code{cached_blocks}
+//' (blocks currently inflated in the cache) and \code{materialized} (whether the vector has
+//' been inflated in full), or \code{NULL} if \code{x} is not a lazy raw vector.
+//' @examples
+//' x <- lazy_raw(as.raw(rep(1:100, 10000)))
+//' invisible(x[1])
+//' lazy_raw_info(x)
+//' @export
+// [[Rcpp::export]]
+SEXP lazy_raw_info(SEXP x) {
+  if (!ALTREP(x) || !R_altrep_inherits(x, lazy_raw_class)) {
+    return R_NilValue;
+  }
+  const LazyRaw& lazy = lazy_state(x);
+  const LazyBlocks& data = *lazy.data;
+  return List::create(Named("length") = static_cast<double>(data.length),
+                      Named("block_size") = static_cast<double>(data.block_size),
+                      Named("blocks") = static_cast<double>(data.blocks.size()),
+                      Named("compressed_size") = static_cast<double>(data.compressed_size),
+                      Named("cached_blocks") = static_cast<double>(lazy.cache.size()),
+                      Named("materialized") = materialized(x));
+}
@@ -0,0 +1,237 @@
+#include <Rcpp.h>
+#include <zlib.h>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <memory>
+#include "dictionary.h"
+#include "gzip.h"
+#include "pool.h"
+#include "stats.h"
+
+using namespace Rcpp;
+
+//' Compress a Whole Buffer in One Call
+//'
+//' Compress a raw vector that is entirely in memory with a single \code{deflate} call into
+//' an output buffer sized by \code{deflateBound}. This is the engine behind \code{compress()}:
+//' no compressor object, no streaming loop and no output regrowth.
+//' @param data A raw vector containing the uncompressed data.
+//' @param level Compression level, integer between 0 and 9, or -1 for default.
+//' @param method Compression method.
+//' @param wbits Window size bits. 8..15 for zlib, 24..31 for gzip and -15..-8 for raw deflate.
+//' @param memLevel Memory level for internal compression state.
+//' @param strategy Compression strategy.
+//' @param zdict Optional predefined compression dictionary as a raw vector.
+//' @param header Optional list of gzip header fields for gzip streams, see \code{create_compressor()}.
+//' @return A raw vector containing the compressed data.
+//' @examples
+//' compressed_data <- compress_buffer(charToRaw("Hello, World"), wbits = 31)
+//' rawToChar(memDecompress(compressed_data, type = "gzip"))
+//' @export
+// [[Rcpp::export]]
+RawVector compress_buffer(const RawVector& data, int level = -1, int method = 8, int wbits = 15,
+                          int memLevel = 8, int strategy = 0, Nullable<RawVector> zdict = R_NilValue,
+                          Nullable<List> header = R_NilValue) {
+  StreamStats stats;
+  StatsScope scope(stats, compress_totals);
+
+  PooledCompressor compressor = acquire_compressor(level, method, wbits, memLevel, strategy);
+  z_stream& strm = compressor->strm;
+  compress_totals.streams.fetch_add(1, std::memory_order_relaxed);
+
+  GzipHeader gzip_header;
+  if (header.isNotNull()) {
+    read_gzip_header(List(header), gzip_header);
+    if (set_gzip_header(strm, gzip_header) != Z_OK) {
+      stop("A gzip header can only be set for gzip streams (wbits 24..31)");
+    }
+  }
+
+  if (zdict.isNotNull()) {
+    RawVector dictVec(zdict);
+    if (deflateSetDictionary(&strm, dictVec.begin(), static_cast<uInt>(dictVec.size())) != Z_OK) {
+      stop("Failed to set dictionary");
+    }
+  }
+
+  const uint8_t* in = data.begin();
+  size_t in_len = static_cast<size_t>(data.size());
+
+  // deflateBound only takes a uLong, so very long vectors add the bound per 4 GiB window
+  size_t bound = 0;
+  for (size_t pos = 0; pos < in_len || pos == 0; pos += UINT_MAX) {
+    bound += deflateBound(&strm, static_cast<uLong>(std::min<size_t>(in_len - pos, UINT_MAX)));
+    if (in_len == 0) break;
+  }
+  std::unique_ptr<uint8_t[]> out(new uint8_t[bound]);  // Left uninitialized, deflate fills it
+  stats.buffer_resizes++;
+
+  size_t consumed = 0;
+  size_t produced = 0;
+  while (true) {
+    size_t remaining = in_len - consumed;
+    int mode = remaining > UINT_MAX ? Z_NO_FLUSH : Z_FINISH;
+    strm.next_in = const_cast<Bytef*>(in + consumed);
+    strm.avail_in = static_cast<uInt>(std::min<size_t>(remaining, UINT_MAX));
+    strm.next_out = out.get() + produced;
+    strm.avail_out = static_cast<uInt>(std::min<size_t>(bound - produced, UINT_MAX));
+    uInt avail_in = strm.avail_in;
+    uInt avail_out = strm.avail_out;
+
+    int ret = deflate(&strm, mode);
+    consumed += avail_in - strm.avail_in;
+    produced += avail_out - strm.avail_out;
+    stats.calls++;
+    stats.flushes[mode]++;
+
+    if (ret < 0 && ret != Z_BUF_ERROR) {
+      Rcpp::Rcerr << "zlib error: " << (strm.msg ? strm.msg : zError(ret)) << std::endl;
+      stop("Compression failed");
+    }
+    if (ret == Z_STREAM_END) {
+      break;
+    }
+    if (produced == bound) {
+      // The bound fell short (e.g. for a preset dictionary); grow rather than spin on Z_BUF_ERROR
+      size_t grown = bound * 2 + 65536;
+      std::unique_ptr<uint8_t[]> larger(new uint8_t[grown]);
+      std::memcpy(larger.get(), out.get(), produced);
+      out = std::move(larger);
+      bound = grown;
+      stats.buffer_resizes++;
+      stats.memmove_bytes += produced;
+    } else if (avail_in == strm.avail_in && avail_out == strm.avail_out) {
+      Rcpp::Rcerr << "zlib error: no progress compressing the buffer" << std::endl;
+      stop("Compression failed");
+    }
+  }
+
+  stats.bytes_in += consumed;
+  stats.bytes_out += produced;
+  stats.stream_ends++;
+  return RawVector(out.get(), out.get() + produced);
+}
+
+//' Decompress a Whole Buffer in One Call
+//'
+//' Decompress a raw vector that is entirely in memory, the engine behind \code{decompress()}.
+//' For a single gzip member the output is allocated once from the ISIZE trailer and inflated
+//' straight into the returned vector. Other input is inflated into a buffer that starts at
+//' four times the input size and grows geometrically. Concatenated streams are all
+//' decompressed; truncated input returns what could be decompressed.
+//' @param data A raw vector containing the compressed data.
+//' @param wbits The window size bits parameter. Default is 0.
+//' @param zdict Optional predefined dictionary as a raw vector.
+//' @return A raw vector containing the decompressed data.
+//' @examples
+//' compressed_data <- compress_buffer(charToRaw("Hello, World"), wbits = 31)
+//' rawToChar(decompress_buffer(compressed_data, wbits = 31))
+//' @export
+// [[Rcpp::export]]
+RawVector decompress_buffer(const RawVector& data, int wbits = 0, Nullable<RawVector> zdict = R_NilValue) {
+  StreamStats stats;
+  StatsScope scope(stats, decompress_totals);
+
+  PooledDecompressor decompressor = acquire_decompressor(wbits);
+  z_stream& strm = decompressor->strm;
+  decompress_totals.streams.fetch_add(1, std::memory_order_relaxed);
+
+  RawVector dictVec;
+  if (zdict.isNotNull()) {
+    dictVec = RawVector(zdict);
+  }
+  const uint8_t* dict = dictVec.size() > 0 ? dictVec.begin() : nullptr;
+  auto set_raw_dictionary = [&]() {
+    if (dict && wbits < 0) {
+      inflateSetDictionary(&strm, dict, static_cast<uInt>(dictVec.size()));  // Raw deflate has no dictionary request
+    }
+  };
+  set_raw_dictionary();
+
+  const uint8_t* in = data.begin();
+  size_t in_len = static_cast<size_t>(data.size());
+  size_t isize = wbits > 15 ? gzip_isize(in, in_len) : 0;
+
+  // The exact size is known: inflate straight into the result
+  RawVector exact;
+  uint8_t* out = nullptr;
+  size_t capacity = 0;
+  std::vector<uint8_t> grown;
+  if (isize > 0) {
+    exact = RawVector(Rcpp::no_init(static_cast<R_xlen_t>(isize)));
+    out = exact.begin();
+    capacity = isize;
+  } else {
+    grown.resize(std::max<size_t>(in_len * 4, 16384));
+    out = grown.data();
+    capacity = grown.size();
+  }
+  stats.buffer_resizes++;
+
+  size_t consumed = 0;
+  size_t produced = 0;
+  bool more_output = false;
+  while (true) {
+    if (produced == capacity) {
+      // The trailer was wrong or more members follow: continue in a growable buffer
+      if (grown.empty()) {
+        grown.assign(out, out + produced);
+        stats.memmove_bytes += produced;
+      }
+      grown.resize(std::max<size_t>(grown.size() * 2, 16384));
+      out = grown.data();
+      capacity = grown.size();
+      stats.buffer_resizes++;
+    }
+
+    strm.next_in = const_cast<Bytef*>(in + consumed);
+    strm.avail_in = static_cast<uInt>(std::min<size_t>(in_len - consumed, UINT_MAX));
+    strm.next_out = out + produced;
+    strm.avail_out = static_cast<uInt>(std::min<size_t>(capacity - produced, UINT_MAX));
+    uInt avail_in = strm.avail_in;
+    uInt avail_out = strm.avail_out;
+
+    int ret = inflate(&strm, Z_NO_FLUSH);
+    consumed += avail_in - strm.avail_in;
+    produced += avail_out - strm.avail_out;
+    stats.calls++;
+    stats.flushes[Z_NO_FLUSH]++;
+    more_output = strm.avail_out == 0;
+
+    if (ret == Z_NEED_DICT) {
+      ret = set_needed_dictionary(strm, dict, static_cast<size_t>(dictVec.size()));
+      if (ret == Z_NEED_DICT) {
+        Rcpp::Rcerr << "zlib error: no dictionary registered for dictionary ID " << strm.adler << std::endl;
+        stop("Decompression failed");
+      }
+    }
+    if (ret == Z_STREAM_END) {
+      stats.stream_ends++;
+      if (consumed == in_len) {
+        break;
+      }
+      inflateReset(&strm);  // Another stream follows in the same input
+      set_raw_dictionary();
+      continue;
+    }
+    if (ret == Z_BUF_ERROR && !more_output) {
+      break;  // Truncated input, keep what was decompressed
+    }
+    if (ret != Z_OK && ret != Z_BUF_ERROR) {
+      Rcpp::Rcerr << "zlib error: " << (strm.msg ? strm.msg : "Unknown error") << std::endl;
+      stop("Decompression failed");
+    }
+  }
+
+  stats.bytes_in += consumed;
+  stats.bytes_out += produced;
+
+  if (grown.empty() && produced == isize) {
+    return exact;
+  }
+  if (grown.empty()) {
+    return RawVector(out, out + produced);  // Shorter than the trailer claimed
+  }
+  return RawVector(grown.begin(), grown.begin() + static_cast<std::ptrdiff_t>(produced));
+}
@@ -0,0 +1,71 @@
+#ifndef ZLIB_PARALLEL_H
+#define ZLIB_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Resolve a user supplied thread count: values <= 0 mean "all available cores".
+inline int resolve_threads(int threads) {
+  if (threads <= 0) {
+    unsigned int hw = std::thread::hardware_concurrency();
+    threads = hw == 0 ? 1 : static_cast<int>(hw);
+  }
+  return threads;
+}
+
+// Run fn(i) for every i in [0, n) on up to `threads` worker threads.
+// Work items are handed out in order through a shared counter. The first exception
+// thrown by a worker is re-thrown on the calling thread once all workers have joined.
+// fn must not touch the R API, it runs outside the main R thread.
+template <typename F>
+void parallel_for(size_t n, int threads, F fn) {
+  size_t workers = std::min(static_cast<size_t>(resolve_threads(threads)), n);
+
+  if (workers <= 1) {
+    for (size_t i = 0; i < n; i++) {
+      fn(i);
+    }
+    return;
+  }
+
+  std::atomic<size_t> next(0);
+  std::atomic<bool> failed(false);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  auto work = [&]() {
+    size_t i;
+    while (!failed.load() && (i = next.fetch_add(1)) < n) {
+      try {
+        fn(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        failed.store(true);
+      }
+    }
+  };
+
+  std::vector<std::thread> pool;
+  pool.reserve(workers - 1);
+  for (size_t t = 1; t < workers; t++) {
+    pool.emplace_back(work);
+  }
+  work();  // The calling thread takes part as well
+  for (auto& thread : pool) {
+    thread.join();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+#endif // ZLIB_PARALLEL_H
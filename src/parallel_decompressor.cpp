@@ -0,0 +1,619 @@
+#include <Rcpp.h>
+#include <zlib.h>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <string>
+#include "decompressor.h"
+#include "gzip.h"
+#include "input_file.h"
+#include "parallel.h"
+#include "pool.h"
+
+using namespace Rcpp;
+
+namespace {
+
+const size_t WINDOW_SIZE = 32768;  // Maximum deflate distance
+const uint16_t MARKER = 256;       // Decoded values >= MARKER stand for window[value - MARKER]
+const size_t NO_START = SIZE_MAX;
+const size_t SEARCH_SIZE = 524288;  // Deflate blocks are far shorter, see find_block()
+
+const uint16_t LENGTH_BASE[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                  31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                  2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t DIST_BASE[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+const uint8_t DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// LSB-first bit reader over the whole compressed input. Reading past the end yields zero
+// bits; callers check overrun() where it matters.
+class BitReader {
+public:
+  BitReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+  void seek(size_t bit) {
+    pos_ = bit >> 3;
+    bits_ = 0;
+    count_ = 0;
+    refill();
+    drop(static_cast<int>(bit & 7));
+  }
+  size_t tell() const { return pos_ * 8 - static_cast<size_t>(count_); }
+  bool overrun() const { return tell() > size_ * 8; }
+
+  // Afterwards at least 57 bits are buffered, enough for a length / distance pair
+  void refill() {
+    if (pos_ + 8 <= size_) {
+      uint64_t word;
+      std::memcpy(&word, data_ + pos_, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+      word = __builtin_bswap64(word);
+#endif
+      bits_ |= word << count_;
+      pos_ += (63 - count_) >> 3;
+      count_ |= 56;
+      return;
+    }
+    while (count_ <= 56) {
+      uint64_t byte = pos_ < size_ ? data_[pos_] : 0;
+      bits_ |= byte << count_;
+      count_ += 8;
+      pos_++;
+    }
+  }
+  uint32_t peek(int n) const { return static_cast<uint32_t>(bits_ & ((uint64_t(1) << n) - 1)); }
+  void drop(int n) {
+    bits_ >>= n;
+    count_ -= n;
+  }
+  uint32_t take(int n) {
+    uint32_t value = peek(n);
+    drop(n);
+    return value;
+  }
+  void align() { drop(count_ & 7); }
+
+private:
+  const uint8_t* data_;
+  size_t size_;
+  size_t pos_ = 0;
+  uint64_t bits_ = 0;
+  int count_ = 0;
+};
+
+// Canonical Huffman code as a single-level lookup table indexed by the next `bits_` bits
+class Huffman {
+public:
+  // Returns false for codes zlib rejects: over-subscribed, or incomplete with more than a
+  // single code (never allowed for the code length code).
+  bool build(const uint8_t* lengths, int n, bool complete) {
+    int count[16] = {0};
+    for (int i = 0; i < n; i++) count[lengths[i]]++;
+    count[0] = 0;
+    int max = 15;
+    while (max > 0 && count[max] == 0) max--;
+    // Validated before the table is filled: the block finder rejects most candidates here
+    int left = 1;
+    for (int len = 1; len <= 15; len++) {
+      left = (left << 1) - count[len];
+      if (left < 0) return false;
+    }
+    if (max == 0) {
+      if (complete) return false;
+    } else if (left > 0 && (complete || max != 1)) {
+      return false;
+    }
+
+    bits_ = std::max(max, 1);
+    table_.assign(size_t(1) << bits_, 0);
+    if (max == 0) {
+      return true;  // No codes at all, e.g. the distance code of a literal-only block
+    }
+
+    uint32_t next[16];
+    uint32_t code = 0;
+    for (int len = 1; len <= 15; len++) {
+      code = (code + count[len - 1]) << 1;
+      next[len] = code;
+    }
+    for (int symbol = 0; symbol < n; symbol++) {
+      int len = lengths[symbol];
+      if (len == 0) continue;
+      uint32_t c = next[len]++;
+      uint32_t reversed = 0;
+      for (int i = 0; i < len; i++) reversed |= ((c >> i) & 1) << (len - 1 - i);
+      for (size_t i = reversed; i < table_.size(); i += size_t(1) << len) {
+        table_[i] = static_cast<uint16_t>(symbol << 4 | len);
+      }
+    }
+    return true;
+  }
+
+  // The next symbol, or -1 for a bit pattern without a code
+  int decode(BitReader& reader) const {
+    uint16_t entry = table_[reader.peek(bits_)];
+    if (entry == 0) return -1;
+    reader.drop(entry & 15);
+    return static_cast<int>(entry >> 4);
+  }
+
+private:
+  std::vector<uint16_t> table_;  // Symbol << 4 | code length, 0 for no code
+  int bits_ = 1;
+};
+
+struct FixedCodes {
+  Huffman literal;
+  Huffman distance;
+  FixedCodes() {
+    uint8_t lengths[288];
+    std::fill(lengths, lengths + 144, 8);
+    std::fill(lengths + 144, lengths + 256, 9);
+    std::fill(lengths + 256, lengths + 280, 7);
+    std::fill(lengths + 280, lengths + 288, 8);
+    literal.build(lengths, 288, false);
+    std::fill(lengths, lengths + 32, 5);  // Codes 30 and 31 complete the code but are invalid
+    distance.build(lengths, 32, false);
+  }
+};
+
+const FixedCodes& fixed_codes() {
+  static const FixedCodes codes;
+  return codes;
+}
+
+// Read the code description of a dynamic block. Returns false if it is not a valid one,
+// which is how the block finder rejects most bit offsets.
+bool read_dynamic_codes(BitReader& reader, Huffman& literal, Huffman& distance, Huffman& lengths_code) {
+  static const uint8_t ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+  reader.refill();
+  int hlit = static_cast<int>(reader.take(5)) + 257;
+  int hdist = static_cast<int>(reader.take(5)) + 1;
+  int hclen = static_cast<int>(reader.take(4)) + 4;
+  if (hlit > 286 || hdist > 30) {
+    return false;
+  }
+
+  uint8_t code_lengths[19] = {0};
+  for (int i = 0; i < hclen; i++) {
+    reader.refill();
+    code_lengths[ORDER[i]] = static_cast<uint8_t>(reader.take(3));
+  }
+  if (!lengths_code.build(code_lengths, 19, true)) {
+    return false;
+  }
+
+  uint8_t lengths[286 + 30];
+  int n = 0;
+  while (n < hlit + hdist) {
+    reader.refill();
+    int symbol = lengths_code.decode(reader);
+    if (symbol < 0) return false;
+    if (symbol < 16) {
+      lengths[n++] = static_cast<uint8_t>(symbol);
+      continue;
+    }
+    int repeat;
+    uint8_t value = 0;
+    if (symbol == 16) {
+      if (n == 0) return false;
+      value = lengths[n - 1];
+      repeat = 3 + static_cast<int>(reader.take(2));
+    } else if (symbol == 17) {
+      repeat = 3 + static_cast<int>(reader.take(3));
+    } else {
+      repeat = 11 + static_cast<int>(reader.take(7));
+    }
+    if (n + repeat > hlit + hdist) return false;
+    std::fill(lengths + n, lengths + n + repeat, value);
+    n += repeat;
+  }
+
+  return lengths[256] != 0 && literal.build(lengths, hlit, false) && distance.build(lengths + hlit, hdist, false);
+}
+
+// A piece of the deflate stream and its output. With speculative decoding the window before
+// `start` is unknown, so references into it are kept as markers until it is.
+struct Chunk {
+  size_t start = NO_START;  // Bit offset of the first block
+  size_t stop = SIZE_MAX;   // Decoding ends at the first block boundary at or after this bit
+  size_t end = 0;           // Bit offset after the last decoded block
+  bool last = false;        // Ended with the final block of the stream
+  bool failed = false;
+  std::vector<uint16_t> out;
+  size_t skip = 0;              // Leading values of `out` that are a known window, not output
+  std::vector<uint8_t> window;  // Output before `start` the markers refer to
+  uLong crc = 0;
+};
+
+// Inflate deflate blocks from chunk.start until a block boundary at or after chunk.stop, or
+// the final block, appending to chunk.out. References before the start of chunk.out become
+// markers if `markers` is set and are errors otherwise. Throws std::runtime_error for invalid
+// or truncated data; runs on worker threads, so it must not touch the R API.
+void inflate_blocks(const uint8_t* data, size_t size, Chunk& chunk, bool markers) {
+  BitReader reader(data, size);
+  reader.seek(chunk.start);
+  std::vector<uint16_t>& out = chunk.out;
+  size_t n = out.size();
+  Huffman literal_code, distance_code, lengths_code;
+
+  while (reader.tell() < chunk.stop) {
+    reader.refill();
+    bool last = reader.take(1) != 0;
+    int type = static_cast<int>(reader.take(2));
+
+    if (type == 0) {
+      reader.align();
+      reader.refill();
+      uint32_t len = reader.take(16);
+      if (len != (~reader.take(16) & 0xffff)) {
+        throw std::runtime_error("invalid stored block lengths");
+      }
+      size_t pos = reader.tell() / 8;
+      if (pos + len > size) {
+        throw std::runtime_error("unexpected end of data");
+      }
+      if (out.size() < n + len) {
+        out.resize(std::max(out.size() * 2, n + len));
+      }
+      std::copy(data + pos, data + pos + len, out.begin() + static_cast<std::ptrdiff_t>(n));
+      n += len;
+      reader.seek((pos + len) * 8);
+    } else if (type == 1 || type == 2) {
+      const Huffman* literal = &fixed_codes().literal;
+      const Huffman* distance = &fixed_codes().distance;
+      if (type == 2) {
+        if (!read_dynamic_codes(reader, literal_code, distance_code, lengths_code)) {
+          throw std::runtime_error("invalid code lengths set");
+        }
+        literal = &literal_code;
+        distance = &distance_code;
+      }
+
+      while (true) {
+        if (out.size() < n + 258) {
+          out.resize(std::max(out.size() * 2, n + 65536));
+        }
+        reader.refill();
+        if (reader.overrun()) throw std::runtime_error("unexpected end of data");
+        int symbol = literal->decode(reader);
+        if (symbol < 256) {
+          if (symbol < 0) throw std::runtime_error("invalid literal/length code");
+          out[n++] = static_cast<uint16_t>(symbol);
+          continue;
+        }
+        if (symbol == 256) {
+          break;
+        }
+        symbol -= 257;
+        if (symbol >= 29) throw std::runtime_error("invalid literal/length code");
+        size_t length = LENGTH_BASE[symbol] + reader.take(LENGTH_EXTRA[symbol]);
+        int dsymbol = distance->decode(reader);
+        if (dsymbol < 0 || dsymbol >= 30) throw std::runtime_error("invalid distance code");
+        size_t dist = DIST_BASE[dsymbol] + reader.take(DIST_EXTRA[dsymbol]);
+
+        if (dist <= n) {
+          const uint16_t* from = out.data() + (n - dist);
+          uint16_t* to = out.data() + n;
+          for (size_t k = 0; k < length; k++) to[k] = from[k];  // Overlapping copies repeat
+        } else {
+          if (!markers || dist > n + WINDOW_SIZE) throw std::runtime_error("invalid distance too far back");
+          for (size_t k = 0; k < length; k++) {
+            std::ptrdiff_t from = static_cast<std::ptrdiff_t>(n + k) - static_cast<std::ptrdiff_t>(dist);
+            out[n + k] = from >= 0 ? out[static_cast<size_t>(from)]
+                                   : static_cast<uint16_t>(MARKER + WINDOW_SIZE + from);
+          }
+        }
+        n += length;
+      }
+    } else {
+      throw std::runtime_error("invalid block type");
+    }
+
+    if (reader.overrun()) {
+      throw std::runtime_error("unexpected end of data");
+    }
+    if (last) {
+      chunk.last = true;
+      break;
+    }
+  }
+
+  out.resize(n);
+  chunk.end = reader.tell();
+}
+
+// First bit offset in [from, to) where a non-final dynamic block starts whose whole first
+// block inflates, or NO_START. Stored and fixed blocks are not guessed; the chunk before then
+// simply decodes further. zlib ends a block after at most 64K symbols, so a block start is
+// normally found within the first SEARCH_SIZE bytes.
+size_t find_block(const uint8_t* data, size_t size, size_t from, size_t to) {
+  BitReader reader(data, size);
+  Huffman literal, distance, lengths_code;
+  to = std::min(std::min(to, size * 8), from + SEARCH_SIZE * 8);
+  for (size_t bit = from; bit < to; bit++) {
+    // Most offsets are ruled out by the first 13 bits: BFINAL 0, BTYPE 10, HLIT and HDIST <= 29
+    size_t byte = bit >> 3;
+    uint32_t head = data[byte];
+    if (byte + 1 < size) head |= static_cast<uint32_t>(data[byte + 1]) << 8;
+    if (byte + 2 < size) head |= static_cast<uint32_t>(data[byte + 2]) << 16;
+    head >>= bit & 7;
+    if ((head & 7) != 4 || (head >> 3 & 31) > 29 || (head >> 8 & 31) > 29) {
+      continue;
+    }
+    reader.seek(bit + 3);
+    if (!read_dynamic_codes(reader, literal, distance, lengths_code) || reader.overrun()) {
+      continue;
+    }
+    Chunk trial;
+    trial.start = bit;
+    trial.stop = bit + 1;
+    try {
+      inflate_blocks(data, size, trial, true);
+    } catch (const std::exception&) {
+      continue;
+    }
+    return bit;
+  }
+  return NO_START;
+}
+
+// Resolve the markers of `out` against the window preceding it
+inline uint8_t resolve(uint16_t value, const std::vector<uint8_t>& window) {
+  if (value < MARKER) return static_cast<uint8_t>(value);
+  return window[value - MARKER - (WINDOW_SIZE - window.size())];
+}
+
+uint32_t read_le32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16 |
+         static_cast<uint32_t>(p[3]) << 24;
+}
+
+// Decode the gzip member at `data` in parallel chunks, appending to `output`. Returns the
+// size of the member in bytes. The member is decoded in rounds of one part per worker, so
+// speculation never runs more than a round past the end of the member and only a round's
+// worth of 16-bit output is held at a time.
+size_t inflate_member(const uint8_t* data, size_t size, int threads, size_t chunk_size, std::vector<uint8_t>& output) {
+  GzipHeaderInfo info;
+  if (!parse_gzip_header(data, size, info)) {
+    throw std::runtime_error("unexpected end of data");
+  }
+  if (info.method != Z_DEFLATED) {
+    throw std::runtime_error("unknown compression method");
+  }
+
+  size_t workers = static_cast<size_t>(resolve_threads(threads));
+  size_t member_start = output.size();
+  uLong crc = crc32(0L, Z_NULL, 0);
+  std::vector<uint8_t> window;  // The last 32 KiB of output, known at the start of every round
+  size_t position = info.size * 8;
+  bool last = false;
+
+  while (!last) {
+    // The first chunk continues from `position` with the known window, the others guess a
+    // block start in their part of the input
+    size_t begin = position / 8;
+    size_t available = std::max<size_t>((size - std::min(begin, size)) / chunk_size, 1);
+    size_t parts = std::min(available, workers);
+    size_t round_end = parts == available ? size : begin + parts * chunk_size;
+    std::vector<size_t> starts(parts, NO_START);
+    starts[0] = position;
+    parallel_for(parts - 1, threads, [&](size_t i) {
+      size_t from = begin + (i + 1) * chunk_size;
+      size_t to = i + 2 < parts ? from + chunk_size : round_end;
+      starts[i + 1] = find_block(data, size, from * 8, to * 8);
+    });
+    starts.erase(std::remove(starts.begin(), starts.end(), NO_START), starts.end());
+
+    std::vector<Chunk> chunks(starts.size());
+    for (size_t i = 0; i < chunks.size(); i++) {
+      chunks[i].start = starts[i];
+      chunks[i].stop = i + 1 < starts.size() ? starts[i + 1] : (round_end == size ? SIZE_MAX : round_end * 8);
+    }
+    chunks[0].out.assign(window.begin(), window.end());
+    chunks[0].skip = window.size();
+    parallel_for(chunks.size(), threads, [&](size_t i) {
+      try {
+        inflate_blocks(data, size, chunks[i], i > 0);
+      } catch (const std::exception&) {
+        if (i == 0) throw;
+        chunks[i].failed = true;  // A wrong guess, decoded again below once its window is known
+      }
+    });
+
+    // Chain the chunks: each must start where the previous one ended. Windows are propagated
+    // in order, which only resolves the last 32 KiB of every chunk.
+    size_t used = 0;
+    for (size_t i = 0; i < chunks.size(); i++) {
+      Chunk& chunk = chunks[i];
+      if (i > 0) {
+        const Chunk& previous = chunks[i - 1];
+        if (previous.last) {
+          break;  // The member ended; what follows is the next member
+        }
+        // A guess decoded before less than a whole window of output has no valid markers
+        if (chunk.failed || chunk.start != previous.end || window.size() < WINDOW_SIZE) {
+          chunk.start = previous.end;
+          chunk.failed = false;
+          chunk.last = false;
+          chunk.out.assign(window.begin(), window.end());
+          chunk.skip = window.size();
+          inflate_blocks(data, size, chunk, false);
+        }
+      }
+      chunk.window = window;
+
+      size_t count = chunk.out.size() - chunk.skip;
+      size_t keep = std::min(count, WINDOW_SIZE);
+      std::vector<uint8_t> next(window.end() - static_cast<std::ptrdiff_t>(std::min(window.size(), WINDOW_SIZE - keep)), window.end());
+      for (size_t k = chunk.out.size() - keep; k < chunk.out.size(); k++) {
+        next.push_back(resolve(chunk.out[k], chunk.window));
+      }
+      window.swap(next);
+      used = i + 1;
+      checkUserInterrupt();
+    }
+    chunks.resize(used);
+    last = chunks.back().last;
+    if (!last && chunks.back().end >= size * 8) {
+      throw std::runtime_error("unexpected end of data");
+    }
+    position = chunks.back().end;
+
+    // Resolve the markers and compute the CRC of every chunk in parallel
+    std::vector<size_t> offsets(chunks.size() + 1, output.size());
+    for (size_t i = 0; i < chunks.size(); i++) {
+      offsets[i + 1] = offsets[i] + chunks[i].out.size() - chunks[i].skip;
+    }
+    output.resize(offsets.back());
+    parallel_for(chunks.size(), threads, [&](size_t i) {
+      Chunk& chunk = chunks[i];
+      uint8_t* to = output.data() + offsets[i];
+      for (size_t k = chunk.skip; k < chunk.out.size(); k++) {
+        *to++ = resolve(chunk.out[k], chunk.window);
+      }
+      std::vector<uint16_t>().swap(chunk.out);
+      size_t len = offsets[i + 1] - offsets[i];
+      chunk.crc = crc32(0L, Z_NULL, 0);
+      for (size_t done = 0; done < len; done += UINT_MAX) {
+        chunk.crc = crc32(chunk.crc, output.data() + offsets[i] + done, static_cast<uInt>(std::min<size_t>(len - done, UINT_MAX)));
+      }
+    });
+    for (size_t i = 0; i < chunks.size(); i++) {
+      crc = crc32_combine64(crc, chunks[i].crc, static_cast<z_off64_t>(offsets[i + 1] - offsets[i]));
+    }
+  }
+
+  size_t trailer = (position + 7) / 8;
+  if (trailer + 8 > size) {
+    throw std::runtime_error("unexpected end of data");
+  }
+  if (read_le32(data + trailer) != crc) {
+    throw std::runtime_error("incorrect data check");
+  }
+  if (read_le32(data + trailer + 4) != static_cast<uint32_t>(output.size() - member_start)) {
+    throw std::runtime_error("incorrect length check");
+  }
+  return trailer + 8;
+}
+
+// BGZF members carry a BC extra field and are at most 64 KiB each, far too small to split
+bool is_bgzf(const uint8_t* data, size_t size) {
+  GzipHeaderInfo info;
+  try {
+    if (!parse_gzip_header(data, size, info) || !info.has_extra) {
+      return false;
+    }
+  } catch (const std::exception&) {
+    return false;  // Reported by the decoder that gets the data
+  }
+  const std::vector<uint8_t>& extra = info.extra;
+  for (size_t pos = 0; pos + 4 <= extra.size();) {
+    if (extra[pos] == 'B' && extra[pos + 1] == 'C') {
+      return true;
+    }
+    pos += 4 + (extra[pos + 2] | (extra[pos + 3] << 8));
+  }
+  return false;
+}
+
+// Decode the rest of the input on the calling thread with zlib
+void inflate_rest(const uint8_t* data, size_t size, std::vector<uint8_t>& output) {
+  PooledDecompressor decompressor = acquire_decompressor(31);
+  decompress_totals.streams.fetch_add(1, std::memory_order_relaxed);
+  StatsScope scope(decompressor->stats, decompress_totals);
+  size_t produced = output.size();
+  size_t consumed = inflate_into(*decompressor, data, size, output, produced, SIZE_MAX);
+  output.resize(produced);
+  if (consumed < size || decompressor->strm.total_in != 0) {
+    Rcpp::Rcerr << "zlib error: unexpected end of data" << std::endl;  // Stopped inside a member
+    stop("Decompression failed");
+  }
+}
+
+}  // namespace
+
+//' Decompress a gzip Stream in Parallel
+//'
+//' Decompress ordinary gzip data, as written by \code{gzip} or \code{compress(wbits = 31)}, on
+//' several threads without an index or BGZF blocks. The input is split into chunks. Every
+//' worker guesses where a deflate block starts in its chunk and decodes from there before the
+//' preceding data is known, keeping references into the unknown 32 KiB window as markers. The
+//' chunks are then chained in order: a chunk is only used if it starts exactly where the
+//' previous one ended (otherwise it is decoded again), and its markers are replaced once the
+//' window before it is known. The CRC-32 and length in the trailer of every member are checked.
+//' @param data A raw vector with the gzip data, or the path of a gzip file.
+//' @param threads Number of threads. 0 uses all available cores.
+//' @param chunk_size Compressed size of the part of the input each worker takes, in bytes.
+//' Default is 4 MiB. Inputs smaller than two chunks are decompressed with zlib on one thread.
+//' @return A raw vector containing the decompressed data.
+//' @details A member is decoded in rounds of one chunk per thread. Decoding speculatively
+//' needs two bytes per output byte of a round until the markers are replaced. Parts made of
+//' stored blocks cannot be guessed into and are decoded by the preceding worker, so
+//' incompressible data gains little. Once a member turns out to be smaller than a chunk, and
+//' for BGZF input, the rest of the input is decompressed with zlib on one thread; use
+//' \code{bgzf_decompress()} for BGZF files.
+//' @examples
+//' data <- charToRaw(paste(sprintf("line %d", 1:200000), collapse = "\n"))
+//' compressed_data <- compress(data, wbits = 31)
+//' identical(gunzip_parallel(compressed_data, threads = 2, chunk_size = 65536), data)
+//' @export
+// [[Rcpp::export]]
+RawVector gunzip_parallel(SEXP data, int threads = 0, double chunk_size = 4194304) {
+  if (chunk_size < 65536) {
+    stop("chunk_size must be at least 65536 bytes");
+  }
+  size_t csize = static_cast<size_t>(chunk_size);
+
+  std::unique_ptr<InputFile> file;
+  std::vector<uint8_t> copy;
+  const uint8_t* in = nullptr;
+  size_t len = 0;
+  if (TYPEOF(data) == STRSXP) {
+    file.reset(new InputFile(as<std::string>(data), 1 << 20));
+    const uint8_t* piece;
+    size_t piece_len;
+    while (file->next(piece, piece_len, SIZE_MAX)) {
+      if (copy.empty() && piece_len == file->size()) {
+        in = piece;  // Memory mapped as a whole
+        len = piece_len;
+        break;
+      }
+      copy.insert(copy.end(), piece, piece + piece_len);
+    }
+    if (!in) {
+      in = copy.data();
+      len = copy.size();
+    }
+  } else if (TYPEOF(data) == RAWSXP) {
+    in = RAW(data);
+    len = static_cast<size_t>(XLENGTH(data));
+  } else {
+    stop("data must be a raw vector or a file path");
+  }
+
+  std::vector<uint8_t> output;
+  size_t pos = 0;
+  bool small_members = is_bgzf(in, len);
+  while (pos < len) {
+    if (threads == 1 || small_members || len - pos < 2 * csize) {
+      inflate_rest(in + pos, len - pos, output);
+      break;
+    }
+    size_t member;
+    try {
+      member = inflate_member(in + pos, len - pos, threads, csize, output);
+    } catch (const std::exception& e) {
+      Rcpp::Rcerr << "zlib error: " << e.what() << std::endl;
+      stop("Decompression failed");
+    }
+    pos += member;
+    // A member that ended in its first chunk gained nothing from the other workers' guesses;
+    // members like it that follow are cheaper to decode with zlib
+    small_members = member <= csize;
+  }
+  return RawVector(output.begin(), output.end());
+}
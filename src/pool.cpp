@@ -0,0 +1,335 @@
+#include <Rcpp.h>
+#include <zlib.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include "pool.h"
+
+using namespace Rcpp;
+
+namespace {
+
+const int MIN_CLASS = 6;               // 64 bytes
+const int MAX_CLASS = 22;              // 4 MiB, larger blocks bypass the free lists
+const size_t HEADER = 16;              // Keeps the blocks handed to zlib 16-byte aligned
+const size_t MAX_CACHED = 64 << 20;    // Freed blocks beyond this go back to the system
+
+struct BlockHeader {
+  size_t bytes;
+  int size_class;  // -1 for blocks larger than MAX_CLASS
+};
+
+struct Arena {
+  std::mutex mutex;
+  std::vector<void*> free_lists[MAX_CLASS + 1];
+  size_t live = 0;    // Bytes held by streams
+  size_t cached = 0;  // Bytes on the free lists
+  size_t peak = 0;
+  size_t limit = 0;   // 0 for none
+  uint64_t failures = 0;
+};
+
+typedef std::array<int, 5> CompressorKey;  // level, method, wbits, memLevel, strategy
+
+struct StreamPool {
+  std::mutex mutex;
+  std::map<CompressorKey, std::vector<Compressor*>> compressors;
+  std::map<int, std::vector<Decompressor*>> decompressors;  // By wbits
+  size_t idle_compressors = 0;
+  size_t idle_decompressors = 0;
+  size_t max_idle = 32;  // Per kind
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+};
+
+Arena arena;
+StreamPool pool;
+
+int size_class(size_t bytes) {
+  int k = MIN_CLASS;
+  while ((size_t(1) << k) < bytes) k++;
+  return k;
+}
+
+// Caller holds arena.mutex
+void trim_cache() {
+  for (std::vector<void*>& list : arena.free_lists) {
+    for (void* block : list) std::free(block);
+    list.clear();
+  }
+  arena.cached = 0;
+}
+
+CompressorKey compressor_key(int level, int method, int wbits, int memLevel, int strategy) {
+  return CompressorKey{{level == Z_DEFAULT_COMPRESSION ? 6 : level, method, wbits, memLevel, strategy}};
+}
+
+// Take idle streams out of the pool until at most `keep` of each kind are left. The
+// caller deletes them after the lock is released.
+void evict(size_t keep, std::vector<Compressor*>& compressors, std::vector<Decompressor*>& decompressors) {
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  for (auto& entry : pool.compressors) {
+    while (pool.idle_compressors > keep && !entry.second.empty()) {
+      compressors.push_back(entry.second.back());
+      entry.second.pop_back();
+      pool.idle_compressors--;
+    }
+  }
+  for (auto& entry : pool.decompressors) {
+    while (pool.idle_decompressors > keep && !entry.second.empty()) {
+      decompressors.push_back(entry.second.back());
+      entry.second.pop_back();
+      pool.idle_decompressors--;
+    }
+  }
+}
+
+}  // namespace
+
+voidpf arena_alloc(voidpf opaque, uInt items, uInt size) {
+  (void)opaque;
+  size_t bytes = static_cast<size_t>(items) * size;
+  int k = bytes <= (size_t(1) << MAX_CLASS) ? size_class(bytes) : -1;
+  size_t block = k >= 0 ? size_t(1) << k : bytes;
+
+  std::lock_guard<std::mutex> lock(arena.mutex);
+  void* p;
+  if (k >= 0 && !arena.free_lists[k].empty()) {
+    p = arena.free_lists[k].back();
+    arena.free_lists[k].pop_back();
+    arena.cached -= block;
+  } else {
+    if (arena.limit && arena.live + arena.cached + block > arena.limit) {
+      trim_cache();
+    }
+    if (arena.limit && arena.live + block > arena.limit) {
+      arena.failures++;
+      return Z_NULL;
+    }
+    p = std::malloc(block + HEADER);
+    if (!p) {
+      arena.failures++;
+      return Z_NULL;
+    }
+    static_cast<BlockHeader*>(p)->bytes = block;
+    static_cast<BlockHeader*>(p)->size_class = k;
+  }
+  arena.live += block;
+  arena.peak = std::max(arena.peak, arena.live);
+  return static_cast<char*>(p) + HEADER;
+}
+
+void arena_free(voidpf opaque, voidpf address) {
+  (void)opaque;
+  if (!address) {
+    return;
+  }
+  void* p = static_cast<char*>(address) - HEADER;
+  const BlockHeader& header = *static_cast<BlockHeader*>(p);
+
+  std::lock_guard<std::mutex> lock(arena.mutex);
+  arena.live -= header.bytes;
+  if (header.size_class >= 0 && arena.cached + header.bytes <= MAX_CACHED) {
+    arena.free_lists[header.size_class].push_back(p);
+    arena.cached += header.bytes;
+  } else {
+    std::free(p);
+  }
+}
+
+PooledCompressor acquire_compressor(int level, int method, int wbits, int memLevel, int strategy) {
+  CompressorKey key = compressor_key(level, method, wbits, memLevel, strategy);
+  {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    auto it = pool.compressors.find(key);
+    if (it != pool.compressors.end() && !it->second.empty()) {
+      Compressor* compressor = it->second.back();
+      it->second.pop_back();
+      pool.idle_compressors--;
+      pool.hits++;
+      return PooledCompressor(compressor);
+    }
+    pool.misses++;
+  }
+
+  PooledCompressor compressor(new Compressor());
+  compressor->strm.zalloc = arena_alloc;
+  compressor->strm.zfree = arena_free;
+  compressor->strm.opaque = Z_NULL;
+  int ret = deflateInit2(&compressor->strm, level, method, wbits, memLevel, strategy);
+  if (ret == Z_MEM_ERROR) {
+    throw std::runtime_error("Failed to initialize compressor: out of memory or over the zlib memory limit");
+  } else if (ret != Z_OK) {
+    throw std::runtime_error("Failed to initialize compressor");
+  }
+  compressor->level = level;
+  compressor->wbits = wbits;
+  compressor->memLevel = memLevel;
+  compressor->strategy = strategy;
+  compressor->pooled = true;
+  return compressor;
+}
+
+PooledDecompressor acquire_decompressor(int wbits) {
+  {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    auto it = pool.decompressors.find(wbits);
+    if (it != pool.decompressors.end() && !it->second.empty()) {
+      Decompressor* decompressor = it->second.back();
+      it->second.pop_back();
+      pool.idle_decompressors--;
+      pool.hits++;
+      return PooledDecompressor(decompressor);
+    }
+    pool.misses++;
+  }
+
+  PooledDecompressor decompressor(new Decompressor());
+  decompressor->strm.zalloc = arena_alloc;
+  decompressor->strm.zfree = arena_free;
+  decompressor->strm.opaque = Z_NULL;
+  decompressor->strm.avail_in = 0;
+  decompressor->strm.next_in = Z_NULL;
+  int ret = inflateInit2(&decompressor->strm, wbits);
+  if (ret == Z_MEM_ERROR) {
+    throw std::runtime_error("Failed to initialize decompressor: out of memory or over the zlib memory limit");
+  } else if (ret != Z_OK) {
+    throw std::runtime_error("Failed to initialize decompressor");
+  }
+  decompressor->wbits = wbits;
+  decompressor->pooled = true;
+  return decompressor;
+}
+
+void release_compressor(Compressor* compressor) {
+  if (!compressor) {
+    return;
+  }
+  compressor->async.reset();  // Joins the worker before the stream is touched
+
+  // Adaptive streams may have switched parameters with deflateParams() and are not reused
+  bool reuse = compressor->pooled && !compressor->bgzf && !compressor->adaptive &&
+               deflateReset(&compressor->strm) == Z_OK;
+  if (reuse) {
+    if (compressor->wbits > 15) {
+      deflateSetHeader(&compressor->strm, Z_NULL);  // deflateReset() keeps the previous header
+    }
+    // Everything but the stream goes back to its default
+    std::vector<uint8_t>().swap(compressor->buffer);
+    std::vector<uint8_t>().swap(compressor->zdict);
+    compressor->header.reset();
+    compressor->stats = StreamStats();
+
+    CompressorKey key = compressor_key(compressor->level, Z_DEFLATED, compressor->wbits,
+                                       compressor->memLevel, compressor->strategy);
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    if (pool.idle_compressors < pool.max_idle) {
+      pool.compressors[key].push_back(compressor);
+      pool.idle_compressors++;
+      return;
+    }
+  }
+  delete compressor;
+}
+
+void release_decompressor(Decompressor* decompressor) {
+  if (!decompressor) {
+    return;
+  }
+  // inflateReset2() also undoes the format a detect mode stream switched to
+  if (decompressor->pooled && inflateReset2(&decompressor->strm, decompressor->wbits) == Z_OK) {
+    std::vector<uint8_t>().swap(decompressor->buffer);
+    std::vector<uint8_t>().swap(decompressor->zdict);
+    decompressor->stats = StreamStats();
+    decompressor->detect = false;
+    decompressor->at_member_start = false;
+    decompressor->total_in = 0;
+    decompressor->total_out = 0;
+    std::vector<StreamMember>().swap(decompressor->members);
+
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    if (pool.idle_decompressors < pool.max_idle) {
+      pool.decompressors[decompressor->wbits].push_back(decompressor);
+      pool.idle_decompressors++;
+      return;
+    }
+  }
+  delete decompressor;
+}
+
+//' Memory Used by zlib Streams
+//'
+//' Inspect and configure the memory behind compressor and decompressor objects and the
+//' single-step functions. Their zlib state is allocated from an arena of power-of-two size
+//' classes that caches freed blocks, and streams that are garbage collected are reset and
+//' kept in a pool by their parameters, so a stream like a previous one is created without
+//' any allocation or initialization.
+//' @param limit Maximum number of bytes the arena may hold, in use or cached, or 0 for no
+//' limit. Creating a stream that would exceed it fails with an error. \code{NULL} keeps the
+//' current limit.
+//' @param pool_size Maximum number of idle streams kept, for compressors and for
+//' decompressors. 0 disables pooling. \code{NULL} keeps the current size (32 by default).
+//' @param trim If \code{TRUE}, free all idle streams and cached blocks.
+//' @return A named numeric vector with \code{live_bytes} (held by streams), \code{peak_bytes},
+//' \code{cached_bytes} (freed blocks kept for reuse), \code{limit}, \code{idle_compressors},
+//' \code{idle_decompressors}, \code{pool_hits} and \code{pool_misses} (streams taken from the
+//' pool or initialized) and \code{failed_allocations}, after applying the arguments.
+//' @examples
+//' zlib_memory()
+//' zlib_memory(limit = 64 * 1024^2)
+//' zlib_memory(limit = 0, trim = TRUE)
+//' @export
+// [[Rcpp::export]]
+NumericVector zlib_memory(Nullable<NumericVector> limit = R_NilValue, Nullable<NumericVector> pool_size = R_NilValue,
+                          bool trim = false) {
+  std::vector<Compressor*> compressors;
+  std::vector<Decompressor*> decompressors;
+  if (pool_size.isNotNull()) {
+    double size = NumericVector(pool_size)[0];
+    if (!(size >= 0)) {
+      stop("pool_size must not be negative");
+    }
+    size_t max_idle = static_cast<size_t>(std::min(size, 1e9));
+    {
+      std::lock_guard<std::mutex> lock(pool.mutex);
+      pool.max_idle = max_idle;
+    }
+    evict(max_idle, compressors, decompressors);
+  }
+  if (trim) {
+    evict(0, compressors, decompressors);
+  }
+  for (Compressor* compressor : compressors) delete compressor;
+  for (Decompressor* decompressor : decompressors) delete decompressor;
+
+  std::lock_guard<std::mutex> pool_lock(pool.mutex);
+  std::lock_guard<std::mutex> lock(arena.mutex);
+  if (limit.isNotNull()) {
+    double bytes = NumericVector(limit)[0];
+    if (!(bytes >= 0)) {
+      stop("limit must not be negative");
+    }
+    arena.limit = std::isfinite(bytes) ? static_cast<size_t>(bytes) : 0;
+    if (arena.limit && arena.live + arena.cached > arena.limit) {
+      trim_cache();
+    }
+  }
+  if (trim) {
+    trim_cache();
+  }
+  return NumericVector::create(
+    Named("live_bytes") = static_cast<double>(arena.live),
+    Named("peak_bytes") = static_cast<double>(arena.peak),
+    Named("cached_bytes") = static_cast<double>(arena.cached),
+    Named("limit") = static_cast<double>(arena.limit),
+    Named("idle_compressors") = static_cast<double>(pool.idle_compressors),
+    Named("idle_decompressors") = static_cast<double>(pool.idle_decompressors),
+    Named("pool_hits") = static_cast<double>(pool.hits),
+    Named("pool_misses") = static_cast<double>(pool.misses),
+    Named("failed_allocations") = static_cast<double>(arena.failures));
+}
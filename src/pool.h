@@ -0,0 +1,35 @@
+#ifndef ZLIB_POOL_H
+#define ZLIB_POOL_H
+
+#include <zlib.h>
+#include <memory>
+#include "compressor.h"
+#include "decompressor.h"
+
+// zalloc / zfree of pooled streams. Blocks are rounded up to power-of-two size classes
+// and freed blocks are cached for the next stream. Live and cached bytes together never
+// exceed the memory limit set with zlib_memory(); past it zalloc returns Z_NULL and zlib
+// reports Z_MEM_ERROR.
+voidpf arena_alloc(voidpf opaque, uInt items, uInt size);
+void arena_free(voidpf opaque, voidpf address);
+
+// Return a stream to the pool, reset, or free it if the pool is full or it cannot be
+// reused. Also the finalizer of the external pointers to pooled objects.
+void release_compressor(Compressor* compressor);
+void release_decompressor(Decompressor* decompressor);
+
+struct CompressorReleaser {
+  void operator()(Compressor* compressor) const { release_compressor(compressor); }
+};
+struct DecompressorReleaser {
+  void operator()(Decompressor* decompressor) const { release_decompressor(decompressor); }
+};
+typedef std::unique_ptr<Compressor, CompressorReleaser> PooledCompressor;
+typedef std::unique_ptr<Decompressor, DecompressorReleaser> PooledDecompressor;
+
+// Take a reset stream with these parameters from the pool, or initialize a new one on the
+// arena. Throws std::runtime_error if zlib rejects the parameters or memory runs out.
+PooledCompressor acquire_compressor(int level, int method, int wbits, int memLevel, int strategy);
+PooledDecompressor acquire_decompressor(int wbits);
+
+#endif // ZLIB_POOL_H
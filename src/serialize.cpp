@@ -0,0 +1,247 @@
+#include <Rcpp.h>
+#include <zlib.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include "compressor.h"
+#include "decompressor.h"
+#include "input_file.h"
+#include "pool.h"
+
+using namespace Rcpp;
+
+namespace {
+
+const size_t STAGE_SIZE = 262144;  // Serialization writes are mostly a few bytes each
+
+// Deflates serialization output as R_Serialize produces it, into memory or a file
+struct ObjectWriter {
+  PooledCompressor compressor;
+  std::vector<uint8_t> staged;
+  std::vector<uint8_t> output;
+  FILE* file = nullptr;
+  std::string path;
+  size_t written = 0;
+
+  ~ObjectWriter() {
+    if (file) fclose(file);
+  }
+
+  void deflate(const uint8_t* in, size_t len, int flush) {
+    size_t produced;
+    {
+      StatsScope scope(compressor->stats, compress_totals);
+      produced = deflate_into(*compressor, in, len, flush);
+    }
+    const uint8_t* out = compressor->buffer.data();
+    written += produced;
+    if (!file) {
+      output.insert(output.end(), out, out + produced);
+    } else if (produced > 0 && fwrite(out, 1, produced, file) != produced) {
+      throw std::runtime_error("Failed to write file: " + path);
+    }
+  }
+
+  void write(const uint8_t* in, size_t len) {
+    if (staged.size() + len > STAGE_SIZE && !staged.empty()) {
+      deflate(staged.data(), staged.size(), Z_NO_FLUSH);
+      staged.clear();
+    }
+    if (len >= STAGE_SIZE) {
+      deflate(in, len, Z_NO_FLUSH);  // Large vectors go to deflate without a copy
+    } else {
+      staged.insert(staged.end(), in, in + len);
+    }
+  }
+
+  void finish() {
+    deflate(staged.data(), staged.size(), Z_FINISH);
+    staged.clear();
+    compressor->stats.stream_ends++;
+    if (file) {
+      int ret = fclose(file);
+      file = nullptr;
+      if (ret != 0) {
+        throw std::runtime_error("Failed to write file: " + path);
+      }
+    }
+  }
+};
+
+// Inflates compressed input, from memory or a file, as R_Unserialize asks for it
+struct ObjectReader {
+  PooledDecompressor decompressor;
+  std::unique_ptr<InputFile> file;
+  const uint8_t* in = nullptr;
+  size_t in_len = 0;
+  size_t in_pos = 0;
+  std::vector<uint8_t> output;
+  size_t output_pos = 0;
+  size_t output_len = 0;
+
+  bool refill() {
+    output_pos = 0;
+    output_len = 0;
+    while (true) {
+      bool eof = false;
+      if (in_pos == in_len) {
+        if (file && file->next(in, in_len, STAGE_SIZE)) {
+          in_pos = 0;
+        } else {
+          eof = true;  // One more pass drains what zlib still holds
+        }
+      }
+      {
+        StatsScope scope(decompressor->stats, decompress_totals);
+        in_pos += inflate_into(*decompressor, in + in_pos, in_len - in_pos, output, output_len, STAGE_SIZE);
+      }
+      if (output_len > 0) {
+        return true;
+      }
+      if (eof) {
+        return false;
+      }
+    }
+  }
+
+  void read(uint8_t* out, size_t len) {
+    while (len > 0) {
+      if (output_pos == output_len && !refill()) {
+        throw std::runtime_error("Compressed object is truncated");
+      }
+      size_t n = std::min(len, output_len - output_pos);
+      std::memcpy(out, output.data() + output_pos, n);
+      output_pos += n;
+      out += n;
+      len -= n;
+    }
+  }
+};
+
+// The stream callbacks are called from R's C code, so C++ exceptions must not escape them.
+// The message is kept and raised with Rf_error() once no C++ object is left on the frame.
+template <typename F>
+void guarded(F fn) {
+  char message[512] = "";
+  try {
+    fn();
+  } catch (const std::exception& e) {
+    std::snprintf(message, sizeof(message), "%s", e.what());
+  }
+  if (message[0]) {
+    Rf_error("%s", message);
+  }
+}
+
+void out_bytes(R_outpstream_t stream, void* buf, int length) {
+  ObjectWriter& writer = *static_cast<ObjectWriter*>(stream->data);
+  guarded([&]() { writer.write(static_cast<const uint8_t*>(buf), static_cast<size_t>(length)); });
+}
+
+void out_char(R_outpstream_t stream, int c) {
+  uint8_t byte = static_cast<uint8_t>(c);
+  out_bytes(stream, &byte, 1);
+}
+
+void in_bytes(R_inpstream_t stream, void* buf, int length) {
+  ObjectReader& reader = *static_cast<ObjectReader*>(stream->data);
+  guarded([&]() { reader.read(static_cast<uint8_t*>(buf), static_cast<size_t>(length)); });
+}
+
+int in_char(R_inpstream_t stream) {
+  ObjectReader& reader = *static_cast<ObjectReader*>(stream->data);
+  if (reader.output_pos < reader.output_len) {
+    return reader.output[reader.output_pos++];
+  }
+  uint8_t byte;
+  in_bytes(stream, &byte, 1);
+  return byte;
+}
+
+}  // namespace
+
+//' Compress an R Object
+//'
+//' Serialize an R object straight into a deflate stream. The bytes \code{R_Serialize} produces
+//' are staged in a small buffer and compressed as they come, so neither the serialized object
+//' nor a scratch copy of it is ever held in memory, only the compressed result. With the
+//' default gzip format and \code{version = 3}, the output is what \code{saveRDS()} writes, so a
+//' file written with \code{file} can also be read with \code{readRDS()}.
+//' @param x An R object.
+//' @param file Optional path of a file to write the compressed object to instead of returning it.
+//' @param level Compression level, integer between 0 and 9, or -1 for default.
+//' @param wbits Window size bits. 31 (default) for gzip, 8..15 for zlib and -15..-8 for raw deflate.
+//' @param version Serialization format version, see \code{serialize()}.
+//' @return A raw vector with the compressed object, or the number of compressed bytes written
+//' to \code{file}.
+//' @examples
+//' compressed <- compress_object(mtcars)
+//' identical(decompress_object(compressed), mtcars)
+//' identical(unserialize(memDecompress(compressed, type = "gzip")), mtcars)
+//' @export
+// [[Rcpp::export]]
+SEXP compress_object(SEXP x, std::string file = "", int level = -1, int wbits = 31, int version = 3) {
+  ObjectWriter writer;
+  writer.compressor = acquire_compressor(level, Z_DEFLATED, wbits, 8, Z_DEFAULT_STRATEGY);
+  compress_totals.streams.fetch_add(1, std::memory_order_relaxed);
+  writer.staged.reserve(STAGE_SIZE);
+  if (!file.empty()) {
+    writer.path = file;
+    writer.file = fopen(file.c_str(), "wb");
+    if (!writer.file) {
+      stop("Failed to open file: " + file);
+    }
+  }
+
+  struct R_outpstream_st stream;
+  R_InitOutPStream(&stream, static_cast<R_pstream_data_t>(&writer), R_pstream_xdr_format, version,
+                   out_char, out_bytes, nullptr, R_NilValue);
+  // R errors during serialization unwind the C++ frames, so the stream returns to the pool
+  Rcpp::unwindProtect([&]() {
+    R_Serialize(x, &stream);
+    return R_NilValue;
+  });
+  writer.finish();
+
+  if (!file.empty()) {
+    return NumericVector::create(static_cast<double>(writer.written));
+  }
+  return RawVector(writer.output.begin(), writer.output.end());
+}
+
+//' Decompress an R Object
+//'
+//' Unserialize an R object straight from a compressed stream, such as the output of
+//' \code{compress_object()}, \code{saveRDS()} or \code{memCompress(serialize(x, NULL))}. The
+//' stream is inflated in small pieces as \code{R_Unserialize} reads it, without holding the
+//' serialized object in memory.
+//' @param data A raw vector with the compressed object, or the path of a file containing it.
+//' @param wbits Window size bits. The default 47 detects zlib and gzip streams.
+//' @return The R object.
+//' @examples
+//' file <- tempfile(fileext = ".rds")
+//' compress_object(iris, file)
+//' identical(decompress_object(file), iris)
+//' identical(readRDS(file), iris)
+//' @export
+// [[Rcpp::export]]
+SEXP decompress_object(SEXP data, int wbits = 47) {
+  ObjectReader reader;
+  reader.decompressor = acquire_decompressor(wbits);
+  decompress_totals.streams.fetch_add(1, std::memory_order_relaxed);
+  if (TYPEOF(data) == STRSXP) {
+    reader.file.reset(new InputFile(as<std::string>(data), STAGE_SIZE));
+  } else if (TYPEOF(data) == RAWSXP) {
+    reader.in = RAW(data);
+    reader.in_len = static_cast<size_t>(XLENGTH(data));
+  } else {
+    stop("data must be a raw vector or a file path");
+  }
+
+  struct R_inpstream_st stream;
+  R_InitInPStream(&stream, static_cast<R_pstream_data_t>(&reader), R_pstream_any_format, in_char, in_bytes,
+                  nullptr, R_NilValue);
+  return Rcpp::unwindProtect([&]() { return R_Unserialize(&stream); });
+}
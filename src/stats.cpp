@@ -0,0 +1,109 @@
+#include <Rcpp.h>
+#include <zlib.h>
+#include "compressor.h"
+#include "decompressor.h"
+#include "stats.h"
+
+using namespace Rcpp;
+
+GlobalStats compress_totals;
+GlobalStats decompress_totals;
+
+namespace {
+
+List stream_stats(const StreamStats& stats) {
+  NumericVector flushes = NumericVector::create(
+    Named("no_flush") = static_cast<double>(stats.flushes[Z_NO_FLUSH]),
+    Named("partial_flush") = static_cast<double>(stats.flushes[Z_PARTIAL_FLUSH]),
+    Named("sync_flush") = static_cast<double>(stats.flushes[Z_SYNC_FLUSH]),
+    Named("full_flush") = static_cast<double>(stats.flushes[Z_FULL_FLUSH]),
+    Named("finish") = static_cast<double>(stats.flushes[Z_FINISH]),
+    Named("block") = static_cast<double>(stats.flushes[Z_BLOCK]),
+    Named("trees") = static_cast<double>(stats.flushes[Z_TREES]));
+
+  return List::create(
+    Named("bytes_in") = static_cast<double>(stats.bytes_in),
+    Named("bytes_out") = static_cast<double>(stats.bytes_out),
+    Named("calls") = static_cast<double>(stats.calls),
+    Named("buffer_resizes") = static_cast<double>(stats.buffer_resizes),
+    Named("memmove_bytes") = static_cast<double>(stats.memmove_bytes),
+    Named("flushes") = flushes,
+    Named("stream_ends") = static_cast<double>(stats.stream_ends),
+    Named("cpu_seconds") = static_cast<double>(stats.cpu_ns) / 1e9);
+}
+
+NumericVector global_stats(const GlobalStats& totals) {
+  return NumericVector::create(
+    Named("streams") = static_cast<double>(totals.streams.load(std::memory_order_relaxed)),
+    Named("bytes_in") = static_cast<double>(totals.bytes_in.load(std::memory_order_relaxed)),
+    Named("bytes_out") = static_cast<double>(totals.bytes_out.load(std::memory_order_relaxed)),
+    Named("calls") = static_cast<double>(totals.calls.load(std::memory_order_relaxed)),
+    Named("buffer_resizes") = static_cast<double>(totals.buffer_resizes.load(std::memory_order_relaxed)),
+    Named("memmove_bytes") = static_cast<double>(totals.memmove_bytes.load(std::memory_order_relaxed)),
+    Named("stream_ends") = static_cast<double>(totals.stream_ends.load(std::memory_order_relaxed)),
+    Named("cpu_seconds") = static_cast<double>(totals.cpu_ns.load(std::memory_order_relaxed)) / 1e9);
+}
+
+}  // namespace
+
+//' Statistics of a Compressor Object
+//'
+//' Return the counters a compressor object has kept since it was created.
+//' @param compressorPtr An external pointer to an existing compressor object.
+//' @return A list with \code{bytes_in}, \code{bytes_out}, \code{calls} (calls into
+//' \code{deflate}), \code{buffer_resizes} (output buffer allocations), \code{memmove_bytes}
+//' (bytes copied inside internal buffers), \code{flushes} (\code{deflate} calls by flush
+//' mode), \code{stream_ends} (completed streams) and \code{cpu_seconds} (CPU time spent
+//' compressing).
+//' @examples
+//' compressor <- create_compressor()
+//' compressed_data <- c(compress_chunk(compressor, charToRaw("Hello, World")),
+//'                      flush_compressor_buffer(compressor))
+//' compressor_stats(compressor)$bytes_out
+//' @export
+// [[Rcpp::export]]
+List compressor_stats(SEXP compressorPtr) {
+  XPtr<Compressor> compressor(compressorPtr);
+  if (!compressor) {
+    stop("Invalid compressor object");
+  }
+  std::unique_lock<std::mutex> lock = lock_stream(*compressor);
+  return stream_stats(compressor->stats);
+}
+
+//' Statistics of a Decompressor Object
+//'
+//' Return the counters a decompressor object has kept since it was created.
+//' @param decompressorPtr An external pointer to an existing decompressor object.
+//' @return A list with the same fields as \code{compressor_stats()}, counting calls into
+//' \code{inflate}.
+//' @examples
+//' decompressor <- create_decompressor()
+//' decompressed_data <- decompress_chunk(decompressor, memCompress(charToRaw("Hello, World")))
+//' decompressor_stats(decompressor)$bytes_out
+//' @export
+// [[Rcpp::export]]
+List decompressor_stats(SEXP decompressorPtr) {
+  XPtr<Decompressor> decompressor(decompressorPtr);
+  if (!decompressor) {
+    stop("Invalid decompressor object");
+  }
+  return stream_stats(decompressor->stats);
+}
+
+//' Process-wide zlib Statistics
+//'
+//' Return the totals of all compressor and decompressor objects of the session, including
+//' those already garbage collected. The counters are updated once per call and can be
+//' read cheaply at any time, e.g. by a metrics exporter.
+//' @return A list with the numeric vectors \code{compress} and \code{decompress}, each
+//' holding \code{streams} (objects created) and the totals of the fields of
+//' \code{compressor_stats()}, except for the flush modes.
+//' @examples
+//' zlib_stats()$compress[["bytes_in"]]
+//' @export
+// [[Rcpp::export]]
+List zlib_stats() {
+  return List::create(Named("compress") = global_stats(compress_totals),
+                      Named("decompress") = global_stats(decompress_totals));
+}
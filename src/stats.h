@@ -0,0 +1,81 @@
+#ifndef ZLIB_STATS_H
+#define ZLIB_STATS_H
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+
+// Counters kept by every compressor and decompressor stream
+struct StreamStats {
+  uint64_t bytes_in = 0;
+  uint64_t bytes_out = 0;
+  uint64_t calls = 0;           // deflate() / inflate() calls
+  uint64_t buffer_resizes = 0;  // Output buffer (re)allocations
+  uint64_t memmove_bytes = 0;   // Bytes copied or shifted inside internal buffers
+  uint64_t flushes[7] = {};     // deflate() / inflate() calls by flush mode, Z_NO_FLUSH .. Z_TREES
+  uint64_t stream_ends = 0;     // Streams completed (Z_STREAM_END) and reset
+  uint64_t cpu_ns = 0;          // CPU time spent compressing / decompressing
+};
+
+// Process-wide totals, updated once per API call with relaxed atomics so they can be
+// scraped at any time without locking.
+struct GlobalStats {
+  std::atomic<uint64_t> streams{0};
+  std::atomic<uint64_t> bytes_in{0};
+  std::atomic<uint64_t> bytes_out{0};
+  std::atomic<uint64_t> calls{0};
+  std::atomic<uint64_t> buffer_resizes{0};
+  std::atomic<uint64_t> memmove_bytes{0};
+  std::atomic<uint64_t> stream_ends{0};
+  std::atomic<uint64_t> cpu_ns{0};
+};
+
+extern GlobalStats compress_totals;
+extern GlobalStats decompress_totals;
+
+// CPU time consumed by the calling thread, in nanoseconds
+inline uint64_t thread_cpu_ns() {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000u + static_cast<uint64_t>(ts.tv_nsec);
+#else
+  return static_cast<uint64_t>(std::clock()) * (1000000000u / CLOCKS_PER_SEC);
+#endif
+}
+
+// Scope of one API call on a stream. On exit the CPU time of the calling thread is added
+// to the stream (unless `timed` is false, for callers that account worker time themselves)
+// and the change of all counters is published to the process-wide totals.
+class StatsScope {
+public:
+  StatsScope(StreamStats& stats, GlobalStats& totals, bool timed = true)
+    : stats_(stats), totals_(totals), before_(stats), timed_(timed),
+      start_(timed ? thread_cpu_ns() : 0) {}
+
+  ~StatsScope() {
+    if (timed_) {
+      stats_.cpu_ns += thread_cpu_ns() - start_;
+    }
+    add(totals_.bytes_in, stats_.bytes_in - before_.bytes_in);
+    add(totals_.bytes_out, stats_.bytes_out - before_.bytes_out);
+    add(totals_.calls, stats_.calls - before_.calls);
+    add(totals_.buffer_resizes, stats_.buffer_resizes - before_.buffer_resizes);
+    add(totals_.memmove_bytes, stats_.memmove_bytes - before_.memmove_bytes);
+    add(totals_.stream_ends, stats_.stream_ends - before_.stream_ends);
+    add(totals_.cpu_ns, stats_.cpu_ns - before_.cpu_ns);
+  }
+
+private:
+  static void add(std::atomic<uint64_t>& total, uint64_t delta) {
+    if (delta) total.fetch_add(delta, std::memory_order_relaxed);
+  }
+
+  StreamStats& stats_;
+  GlobalStats& totals_;
+  StreamStats before_;
+  bool timed_;
+  uint64_t start_;
+};
+
+#endif // ZLIB_STATS_H
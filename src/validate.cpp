@@ -1,11 +1,130 @@
 #include <Rcpp.h>
 #include <zlib.h>
+#include <cstring>
+#include "input_file.h"
+#include "parallel.h"
+
+using namespace Rcpp;
+
+namespace {
+
+const size_t WINDOW = 4194304;  // Input handed to inflate per call
+const size_t SCRATCH = 262144;  // Output is checked and discarded
+
+// Outcome of validating one file. error_offset is the compressed offset at which the
+// corruption or truncation was detected, or -1 for a valid file.
+struct GzipCheck {
+  bool valid = false;
+  int members = 0;
+  double compressed_size = NA_REAL;
+  double uncompressed_size = 0;
+  int crc_ok = NA_LOGICAL;
+  double error_offset = -1;
+  std::string error;
+};
+
+struct StreamGuard {
+  z_stream* strm;
+  ~StreamGuard() { inflateEnd(strm); }
+};
+
+// Inflate every member of the file and check its CRC and length, without the R API so it
+// can run on worker threads. Anything after the last member other than another valid
+// member makes the file invalid.
+GzipCheck check_gzip_file(const std::string& path) {
+  GzipCheck result;
+  try {
+    InputFile input(path, WINDOW);
+    result.compressed_size = static_cast<double>(input.size());
+
+    z_stream strm{};
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    if (inflateInit2(&strm, 15 + 32) != Z_OK) {
+      throw std::runtime_error("Failed to initialize decompressor");
+    }
+    StreamGuard guard{&strm};
+    std::vector<uint8_t> scratch(SCRATCH);
+
+    uint64_t offset = 0;        // Compressed bytes consumed so far
+    uint64_t member_start = 0;
+    bool in_member = false;
+    const uint8_t* data = nullptr;
+    size_t len = 0;
+
+    while (result.error.empty() && input.next(data, len, WINDOW)) {
+      size_t pos = 0;
+      while (pos < len) {
+        if (!in_member) {
+          inflateReset(&strm);
+          in_member = true;
+          member_start = offset;
+        }
+
+        strm.next_in = const_cast<Bytef*>(data + pos);
+        strm.avail_in = static_cast<uInt>(len - pos);
+        int ret;
+        do {
+          strm.next_out = scratch.data();
+          strm.avail_out = static_cast<uInt>(scratch.size());
+          ret = inflate(&strm, Z_NO_FLUSH);
+          result.uncompressed_size += static_cast<double>(scratch.size() - strm.avail_out);
+        } while (ret == Z_OK && strm.avail_out == 0);
+
+        size_t consumed = (len - pos) - strm.avail_in;
+        pos += consumed;
+        offset += consumed;
+
+        if (ret == Z_STREAM_END) {
+          result.members++;
+          result.crc_ok = TRUE;
+          in_member = false;
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+          if (result.members > 0 && strm.total_in < 10 && ret == Z_DATA_ERROR) {
+            result.error = "trailing garbage after the last member";
+            result.error_offset = static_cast<double>(member_start);
+          } else {
+            result.error = strm.msg ? strm.msg : zError(ret);
+            result.error_offset = static_cast<double>(offset);
+            if (std::strcmp(result.error.c_str(), "incorrect data check") == 0) {
+              result.crc_ok = FALSE;
+            }
+          }
+          break;
+        }
+      }
+    }
+
+    if (result.error.empty() && in_member) {
+      if (result.members > 0 && strm.total_in < 10) {
+        result.error = "trailing garbage after the last member";
+        result.error_offset = static_cast<double>(member_start);
+      } else {
+        result.error = "unexpected end of file";
+        result.error_offset = static_cast<double>(offset);
+      }
+    } else if (result.error.empty() && result.members == 0) {
+      result.error = "empty file";
+      result.error_offset = 0;
+    }
+    result.valid = result.error.empty();
+  } catch (const std::exception& e) {
+    result.error = e.what();
+    result.valid = false;
+  }
+  return result;
+}
+
+}  // namespace
 
 //' Validate if a File is a Valid Gzip File
 //'
 //' This function takes a file path as input and checks if it's a valid gzip-compressed file.
-//' It reads the file in chunks and tries to decompress it using the zlib library.
-//' If any step fails, the function returns \code{FALSE}. Otherwise, it returns \code{TRUE}.
+//' Every member is decompressed and its CRC and length are checked, and nothing but valid
+//' members may follow the first one. If any step fails, the reason is printed and the
+//' function returns \code{FALSE}. Otherwise, it returns \code{TRUE}. Use
+//' \code{validate_gzip_files()} to check many files at once and get the details.
 //'
 //' @param file_path A string representing the path of the file to validate.
 //' @return A boolean value indicating whether the file is a valid gzip file.
@@ -15,67 +134,70 @@
 //' @export
 // [[Rcpp::export]]
 bool validate_gzip_file(const std::string& file_path) {
-  FILE* file = fopen(file_path.c_str(), "rb");
-  if (!file) {
-    Rcpp::Rcerr << "Failed to open file: " << file_path << std::endl;
-    return false;
+  GzipCheck result = check_gzip_file(file_path);
+  if (!result.valid) {
+    Rcpp::Rcerr << "Validation failed for " << file_path << ": " << result.error << std::endl;
   }
+  return result.valid;
+}
 
-  z_stream strm;
-  strm.zalloc = Z_NULL;
-  strm.zfree = Z_NULL;
-  strm.opaque = Z_NULL;
-  strm.avail_in = 0;
-  strm.next_in = Z_NULL;
-  if (inflateInit2(&strm, 15+32) != Z_OK) {
-    fclose(file);
-    return false;
+//' Validate Many Gzip Files in Parallel
+//'
+//' Check a batch of gzip (or zlib) files on a pool of threads. Each file is memory mapped
+//' where supported and all of its members are decompressed, with their CRC and length
+//' checked. Nothing is printed, the outcome is returned per file.
+//' @param paths A character vector of file paths.
+//' @param threads Number of worker threads. 0 uses all available cores.
+//' @return A data frame with one row per path and the columns \code{path}, \code{valid},
+//' \code{members} (complete members), \code{compressed_size} (file size),
+//' \code{uncompressed_size} (bytes decompressed before any error), \code{crc_ok}
+//' (\code{FALSE} if a CRC-32 or Adler-32 check failed, \code{NA} if none was reached),
+//' \code{error_offset} (compressed byte offset at which the corruption, truncation or trailing
+//' garbage was detected, \code{NA} for valid files) and \code{error} (\code{NA} for valid files).
+//' @examples
+//' input_file <- tempfile()
+//' writeLines(rep("Hello, World", 1000), input_file)
+//' gzip_file(input_file, paste0(input_file, ".gz"))
+//' validate_gzip_files(c(paste0(input_file, ".gz"), input_file))
+//' @export
+// [[Rcpp::export]]
+DataFrame validate_gzip_files(const CharacterVector& paths, int threads = 0) {
+  size_t n = static_cast<size_t>(paths.size());
+  std::vector<std::string> files(n);
+  for (size_t i = 0; i < n; i++) {
+    files[i] = as<std::string>(paths[i]);
   }
 
-  const size_t chunk_size = 1024;
-  Bytef in[chunk_size];
-  Bytef out[chunk_size];
-  int ret;
-  bool success = true;  // Flag to indicate success or failure
-
-  do {
-    strm.avail_in = fread(in, 1, chunk_size, file);
-    if (ferror(file)) {
-      Rcpp::Rcerr << "File read error" << std::endl;
-      success = false;
-      break;
-    }
-    strm.next_in = in;
-
-    do {
-      strm.avail_out = chunk_size;
-      strm.next_out = out;
-      ret = inflate(&strm, Z_NO_FLUSH);
-
-      if (ret == Z_STREAM_ERROR) {
-        Rcpp::Rcerr << "Stream error during decompression" << std::endl;
-        success = false;
-        break;
-      } else if (ret == Z_MEM_ERROR) {
-        Rcpp::Rcerr << "Memory error during decompression" << std::endl;
-        success = false;
-        break;
-      } else if (ret == Z_DATA_ERROR) {
-        Rcpp::Rcerr << "Data error during decompression" << std::endl;
-        success = false;
-        break;
-      }
-
-    } while (strm.avail_out == 0);
+  std::vector<GzipCheck> results(n);
+  parallel_for(n, threads, [&](size_t i) {
+    results[i] = check_gzip_file(files[i]);
+  });
 
-    if (!success) {
-      break;
+  LogicalVector valid(n);
+  IntegerVector members(n);
+  NumericVector compressed_size(n);
+  NumericVector uncompressed_size(n);
+  LogicalVector crc_ok(n);
+  NumericVector error_offset(n);
+  CharacterVector error(n);
+  for (size_t i = 0; i < n; i++) {
+    const GzipCheck& r = results[i];
+    valid[i] = r.valid;
+    members[i] = r.members;
+    compressed_size[i] = r.compressed_size;
+    uncompressed_size[i] = r.uncompressed_size;
+    crc_ok[i] = r.crc_ok;
+    error_offset[i] = r.error_offset < 0 ? NA_REAL : r.error_offset;
+    if (r.valid) {
+      error[i] = NA_STRING;
+    } else {
+      error[i] = r.error;
     }
+  }
 
-  } while (ret != Z_STREAM_END);
-
-  inflateEnd(&strm);
-  fclose(file);
-
-  return success;
+  return DataFrame::create(Named("path") = paths, Named("valid") = valid, Named("members") = members,
+                           Named("compressed_size") = compressed_size,
+                           Named("uncompressed_size") = uncompressed_size, Named("crc_ok") = crc_ok,
+                           Named("error_offset") = error_offset, Named("error") = error,
+                           Named("stringsAsFactors") = false);
 }
@@ -0,0 +1,120 @@
+#include <Rcpp.h>
+#include <zlib.h>
+#include <cstring>
+#include "compressor.h"
+#include "decompressor.h"
+
+using namespace Rcpp;
+
+namespace {
+
+// Every sync flush ends with an empty stored block. RFC 7692 leaves it out of the message
+const uint8_t SYNC_TAIL[4] = {0x00, 0x00, 0xff, 0xff};
+
+}  // namespace
+
+//' Compress a WebSocket Message (permessage-deflate)
+//'
+//' Compress one message for the permessage-deflate extension (RFC 7692) with a raw deflate
+//' compressor. The message is deflated with \code{Z_SYNC_FLUSH} in a single call into the
+//' compressor's scratch buffer and the trailing \code{00 00 ff ff} is removed. Unless the
+//' context is reset, the next message can refer back to this one, which is where most of the
+//' gain on small messages comes from. Usually called through \code{permessage_deflate()}.
+//' @param compressorPtr An external pointer to a compressor created with negative \code{wbits},
+//' i.e. \code{-max_window_bits} as negotiated (9..15).
+//' @param message A raw vector with the message payload.
+//' @param no_context_takeover If \code{TRUE}, the compressor is reset after the message, as
+//' required when \code{no_context_takeover} was negotiated for this side.
+//' @return A raw vector with the compressed payload, to be sent with the RSV1 bit set.
+//' @examples
+//' deflater <- create_compressor(wbits = -15)
+//' payload <- ws_deflate_message(deflater, charToRaw("Hello"))
+//' rawToChar(ws_inflate_message(create_decompressor(wbits = -15), payload))
+//' @export
+// [[Rcpp::export]]
+RawVector ws_deflate_message(SEXP compressorPtr, const RawVector& message, bool no_context_takeover = false) {
+  XPtr<Compressor> compressor(compressorPtr);
+  if (!compressor) {
+    stop("Invalid compressor object");
+  }
+  if (compressor->bgzf || compressor->async || compressor->wbits >= 0) {
+    stop("permessage-deflate needs a synchronous raw deflate compressor (negative wbits)");
+  }
+
+  StatsScope scope(compressor->stats, compress_totals);
+  size_t produced = deflate_into(*compressor, message.begin(), static_cast<size_t>(message.size()), Z_SYNC_FLUSH);
+  const uint8_t* out = compressor->buffer.data();
+  RawVector result(1);  // An empty message right after a flush gives no output, RFC 7692 sends 0x00
+  if (produced > 0) {
+    if (produced < 4 || std::memcmp(out + produced - 4, SYNC_TAIL, 4) != 0) {
+      stop("Compressed message does not end with a sync flush");
+    }
+    result = RawVector(out, out + produced - 4);
+  }
+
+  if (no_context_takeover) {
+    deflateReset(&compressor->strm);
+    if (!compressor->zdict.empty()) {
+      // Raw deflate carries no dictionary ID, so the receiver sets it up front after every reset
+      deflateSetDictionary(&compressor->strm, compressor->zdict.data(), static_cast<uInt>(compressor->zdict.size()));
+    }
+    compressor->stats.stream_ends++;
+  }
+  return result;
+}
+
+//' Decompress a WebSocket Message (permessage-deflate)
+//'
+//' Decompress the payload of one message compressed with the permessage-deflate extension
+//' (RFC 7692) with a raw deflate decompressor. The \code{00 00 ff ff} the sender removed is
+//' fed after the payload without copying it. Usually called through \code{permessage_deflate()}.
+//' @param decompressorPtr An external pointer to a decompressor created with negative
+//' \code{wbits}, i.e. \code{-max_window_bits} as negotiated for the peer (8..15).
+//' @param payload A raw vector with the compressed payload of a message (RSV1 set).
+//' @param no_context_takeover If \code{TRUE}, the decompressor is reset after the message, as
+//' required when the peer resets its compressor.
+//' @param max_size Maximum size of the decompressed message in bytes, or -1 for no limit.
+//' Larger messages raise an error instead of being inflated completely.
+//' @return A raw vector with the message.
+//' @examples
+//' deflater <- create_compressor(wbits = -15)
+//' inflater <- create_decompressor(wbits = -15)
+//' for (i in 1:3) {
+//'   payload <- ws_deflate_message(deflater, charToRaw(sprintf("{\"event\": \"tick\", \"n\": %d}", i)))
+//'   print(rawToChar(ws_inflate_message(inflater, payload)))
+//' }
+//' @export
+// [[Rcpp::export]]
+RawVector ws_inflate_message(SEXP decompressorPtr, const RawVector& payload, bool no_context_takeover = false,
+                             double max_size = -1) {
+  XPtr<Decompressor> decompressor(decompressorPtr);
+  if (!decompressor) {
+    stop("Invalid decompressor object");
+  }
+  if (decompressor->wbits >= 0) {
+    stop("permessage-deflate needs a raw deflate decompressor (negative wbits)");
+  }
+
+  StatsScope scope(decompressor->stats, decompress_totals);
+  // One byte over the limit tells a message of exactly max_size from a larger one
+  size_t limit = max_size < 0 ? SIZE_MAX : static_cast<size_t>(max_size) + 1;
+  std::vector<uint8_t> out;
+  size_t produced = 0;
+  size_t in_len = static_cast<size_t>(payload.size());
+  uint64_t stream_ends = decompressor->stats.stream_ends;
+  size_t consumed = inflate_into(*decompressor, payload.begin(), in_len, out, produced, limit);
+  // A message may end with a BFINAL block (RFC 7692 7.2.3.3). The stream has then been reset
+  // and the tail would start a stored block in the next message, so it is left out.
+  if (consumed == in_len && decompressor->stats.stream_ends == stream_ends) {
+    inflate_into(*decompressor, SYNC_TAIL, sizeof(SYNC_TAIL), out, produced, limit);
+  }
+  if (max_size >= 0 && produced > max_size) {
+    reset_decompressor(*decompressor);  // The rest of the message is dropped with its context
+    stop("Message exceeds max_size");
+  }
+
+  if (no_context_takeover) {
+    reset_decompressor(*decompressor);
+  }
+  return RawVector(out.begin(), out.begin() + static_cast<std::ptrdiff_t>(produced));
+}